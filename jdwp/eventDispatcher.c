@@ -7,6 +7,7 @@
 #include "misc/MEventkind.h"
 #include "commandsets/MCommandsets.h"
 #include "commandsets/Event.h"
+#include "commandsets/EventRequest.h"
 #include "initializer.h"
 
 #define CS_EVENT_COMPOSITE_EXTRA (byte__SIZE + int__SIZE)
@@ -31,6 +32,18 @@ static EventRequestList** eventBags; // will follow the strict reporting rules
 
 static volatile u4 eventRequestid_count;
 
+// Lock-free view of eList for the VM thread.  Every mutation of eList
+// recounts it under MUTEX_T and publishes the counts with release
+// stores into the same words, check_forEvents only does an acquire
+// load per opcode and nothing is allocated or retired.
+// Breakpoints with a LocationOnly modifier are not part of it: they are
+// patched into the code (index = byte offset from the method's first
+// opcode, see VMController->set_breakpoint)
+// and reported through EventHandler->breakpoint when the VM traps.
+static volatile u4 eventsImmediate; // triggered requests without location
+static volatile u1 eventsArmed;
+static volatile u1 eventsActive;
+
 // internal forwards
 // sets hold flag on dispatcher
 static void holdEvents(u1 hold);
@@ -48,7 +61,10 @@ static u1 canDispatchAll();
 static EventRequest* newEventRequest();
 
 // callback for vm
-static void check_forEvents(u1 scode, Cell* sp, Cell* fp, methodid_t method);
+static void check_forEvents(u1* cp, Cell* sp, Cell* fp, methodid_t method);
+
+// republishes the VM side counts, MUTEX_T must be held
+static void publishSnapshot();
 
 static void internalWriteCompositeSet(Packet* p, PacketList* pList);
 
@@ -303,6 +319,58 @@ inline static Packet* internalDispatch(EventRequest* e) {
     return p;
 }
 
+// location of a breakpoint request, NULL for any other request
+inline static Location* locationOf(EventRequest* e) {
+    u4 i;
+
+    if(e->eventKind != BREAKPOINT)
+        return NULL;
+
+    for(i = 0; i < e->modCount; i++) {
+        if(e->mods[i].modKind == MODKIND_LocationOnly)
+            return &e->mods[i].locationOnly.loc;
+    }
+
+    return NULL;
+}
+
+inline static void publishSnapshot() {
+    EventRequestBuff* cur;
+    u4 immediate = 0;
+    u1 active = FALSE;
+
+    for(cur = eList->head; cur != NULL; cur = cur->next) {
+        if(cur->eventRequest->isremoved == TRUE)
+            continue;
+
+        active = TRUE;
+        if(cur->eventRequest->triggered == TRUE && locationOf(cur->eventRequest) == NULL)
+            immediate++;
+    }
+
+    __atomic_store_n(&eventsImmediate, immediate, __ATOMIC_RELEASE);
+    __atomic_store_n(&eventsArmed, (u1) (immediate > 0), __ATOMIC_RELEASE);
+    __atomic_store_n(&eventsActive, active, __ATOMIC_RELEASE);
+}
+
+// callback for the VM when it traps on a patched location
+inline static void onBreakpoint(methodid_t mid, u8 index) {
+    EventRequestBuff* cur;
+    Location* loc;
+
+    __LOCK
+    for(cur = eList->head; cur != NULL; cur = cur->next) {
+        if(cur->eventRequest->isremoved == TRUE || (loc = locationOf(cur->eventRequest)) == NULL)
+            continue;
+
+        if(loc->methodID == mid && loc->index == index)
+            cur->eventRequest->triggered = TRUE;
+    }
+    __UNLOCK
+
+    VMController->suspend();
+}
+
 inline static PacketList* get_by_suspendPolicy(u1 pol) {
     EventRequestBuff* event = eList->head;
 
@@ -322,7 +390,9 @@ inline static PacketList* get_by_suspendPolicy(u1 pol) {
             Packet* p = internalDispatch(event->eventRequest);
 
             event->eventRequest->triggered = FALSE;
-            event->eventRequest->isremoved = TRUE;
+            if(locationOf(event->eventRequest) == NULL) { // breakpoints stay until cleared
+                event->eventRequest->isremoved = TRUE;
+            }
             if(p->offset > 0) {
                 PacketHandler->add_Packet(p, pList);
             }
@@ -347,28 +417,11 @@ inline static EventRequest* get_EventRequest_byRequestID(u4 id) {
     return NULL;
 }
 
-inline static void check_forEvents(u1 scode, Cell* sp, Cell* fp, methodid_t method) {
-    __LOCK
-    size_t count = eList->size;
-
-    //printf("Halt on opcpde = %s\n", opcodeToName(scode));
-    if(count == 0) {
-        __UNLOCK
-        return;
-    }
-
-    size_t start = 0;
-    EventRequestBuff* curr = eList->head;
-
-    while(start++ < count) {
-        if(curr->eventRequest->isremoved == FALSE && curr->eventRequest->triggered == TRUE) { // ignore modifiers
-            __UNLOCK
-            VMController->suspend();
-            return;
-        }
-        curr = curr->next;
+// cp is the current opcode, method the block index of the executing method
+inline static void check_forEvents(u1* cp, Cell* sp, Cell* fp, methodid_t method) {
+    if(__atomic_load_n(&eventsImmediate, __ATOMIC_ACQUIRE) > 0) {
+        VMController->suspend();
     }
-    __UNLOCK
 }
 
 // event crafter
@@ -380,15 +433,27 @@ inline static EventRequest* newEventRequest() {
     return e;
 }
 
-inline static void add_EventRequest(EventRequest* e) {
-    EventRequestBuff* erBuff = (EventRequestBuff*) malloc(sizeof(EventRequestBuff));
-    erBuff->eventRequest = e;
+// FALSE if the request's location can't be patched, it is not added then
+inline static u1 add_EventRequest(EventRequest* e) {
+    EventRequestBuff* erBuff;
+    Location* loc = locationOf(e);
+    if(loc != NULL) { // waits for the VM to reach its location
+        e->triggered = FALSE;
+    }
+
+    __LOCK
+    if(loc != NULL && VMController->set_breakpoint(loc) == FALSE) {
+        __UNLOCK
+        return FALSE;
+    }
+
     if(e->eventKind == THREAD_START) {
         _erTHREAD_START = e;
         //return;
     }
 
-    __LOCK
+    erBuff = (EventRequestBuff*) malloc(sizeof(EventRequestBuff));
+    erBuff->eventRequest = e;
     erBuff->next = eList->head;
 
     eList->head = erBuff;
@@ -397,20 +462,35 @@ inline static void add_EventRequest(EventRequest* e) {
     // log events
     print_eventrequests();
 
+    publishSnapshot();
     __UNLOCK
+    return TRUE;
+}
+
+inline static void unpatch(EventRequest* e) {
+    Location* loc = locationOf(e);
+    if(loc != NULL && e->isremoved == FALSE) {
+        VMController->clear_breakpoint(loc);
+    }
 }
 
 inline static void internal_remove(u1 kind, u4 id) {
     EventRequestBuff* cur = eList->head;
 
+    if(cur == NULL) {
+        return;
+    }
+
     if(cur->eventRequest->requestId == id && cur->eventRequest->eventKind == kind) {
-        eList->size = 0;
-        eList->head = NULL;
+        unpatch(cur->eventRequest);
+        eList->head = cur->next;
+        eList->size = eList->size - 1;
         return;
     }
 
     while(cur->next != NULL) {
-        if(cur->next->eventRequest->requestId == id && cur->eventRequest->eventKind == kind) {
+        if(cur->next->eventRequest->requestId == id && cur->next->eventRequest->eventKind == kind) {
+            unpatch(cur->next->eventRequest);
             cur->next = cur->next->next;
             eList->size = eList->size - 1;
             return;
@@ -433,6 +513,7 @@ inline static void sync_end() {
 inline static void remove_EventRequest_byKind_RequestID(u1 kind, u4 id) {
     __LOCK
     internal_remove(kind, id);
+    publishSnapshot();
     __UNLOCK
 }
 
@@ -443,6 +524,7 @@ inline static void removeAll_EventRequests_byKind(u1 ekind) {
     while(cur != NULL) {
         if(cur->eventRequest->eventKind == ekind) {
             internal_remove(cur->eventRequest->eventKind, cur->eventRequest->requestId);
+            publishSnapshot();
             __UNLOCK
 
             removeAll_EventRequests_byKind(ekind);
@@ -457,6 +539,9 @@ inline static void removeAll_EventRequests_byKind(u1 ekind) {
 
 inline static void holdEvents(u1 hold) {
     HOLD_EVENTS = hold;
+    if(hold == FALSE) {
+        VMController->wake(); // VM may be parked waiting to dispatch
+    }
 }
 
 inline static u1 canDispatchAll() {
@@ -475,7 +560,11 @@ inline static void dispatchEvent(EventRequest* e) {
     }
     printf("Dispatch single Event: %s\n", eventKind_to_cstr(e->eventKind));
 
+    __LOCK
     e->triggered = FALSE;
+    publishSnapshot();
+    __UNLOCK
+
     Packet* p = internalDispatch(e);
     Packet* cmd = PacketHandler->newCommandPacket(p->offset + CS_EVENT_COMPOSITE_EXTRA, EComposite, CSEvent);
     PacketHandler->write_u1(cmd, e->suspendPolicy);
@@ -515,11 +604,14 @@ inline static void dispatchAll() {
     PacketList* pList_suspend_tid   = get_by_suspendPolicy(SP_EVENT_THREAD);
     PacketList* pList_suspend_all   = get_by_suspendPolicy(SP_ALL);
 
+    publishSnapshot();
     __UNLOCK
 
+    MHandler->jdwpCork(TRUE);
     internalDispatchSet(pList_suspend_none, SP_NONE);
     internalDispatchSet(pList_suspend_tid, SP_EVENT_THREAD);
     internalDispatchSet(pList_suspend_all, SP_ALL);
+    MHandler->jdwpCork(FALSE);
 }
 
 inline static void dispatch_VM_Init() {
@@ -553,7 +645,13 @@ void init_eventDispatcher() {
     EventHandler->canDispatchAll = canDispatchAll;
     EventHandler->newEvent = newEventRequest;
     EventHandler->check_forEvents = check_forEvents;
+    EventHandler->armed = &eventsArmed;
+    EventHandler->active = &eventsActive;
+    EventHandler->breakpoint = onBreakpoint;
 
     int mret;
     mret = pthread_mutex_init(&MUTEX_T, NULL);
+
+    eList->head = NULL;
+    publishSnapshot();
 }
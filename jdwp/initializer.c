@@ -140,7 +140,8 @@ inline static RefTypeID* main_class() {
     // Constructor
     method* constructorMethod = (method*) malloc(sizeof(method));
     constructorMethod->methodName = "<init>";
-    constructorMethod->mid = 1;
+    constructorMethod->mid = 0;
+    constructorMethod->block = 0;
     constructorMethod->methodJNISignature = MFileManager->mku2("()V");
     constructorMethod->modBits = ACC_PUBLIC | ACC_SYNTHETIC;
     constructorMethod->startline = 1;
@@ -161,6 +162,7 @@ inline static RefTypeID* main_class() {
     mainMethod->methodJNISignature = MFileManager->mku2("([Ljava/lang/String;)V");
     mainMethod->modBits = ACC_PUBLIC | ACC_STATIC;
     mainMethod->mid = 1;
+    mainMethod->block = 0; // bound by the VM to the image's main block
     mainMethod->startline = 3;
     mainMethod->endline   = 4;
     mainMethod->lines = 1;
@@ -185,7 +187,7 @@ inline static RefTypeID* main_class() {
 
 // This seems to be buggy
 inline static bool progress_jbase_line(u1* entry) {
-    RefTypeID* typeID       = (RefTypeID*) malloc(sizeof(RefTypeID));
+    RefTypeID* typeID       = (RefTypeID*) calloc(1, sizeof(RefTypeID)); // signature filled in on registration
     typeID->status          = (CLASSSTATUS_VERIFIED | CLASSSTATUS_PREPARED | CLASSSTATUS_INITIALIZED);
 
     typeID->num_fields      = 0;
@@ -290,6 +292,7 @@ inline static bool progress_jbase_line(u1* entry) {
         method* mMethod         = (method*) malloc(sizeof(method));
         // MethodUID
         mMethod->mid            = (methodid_t) start;
+        mMethod->block          = 0;
         // MethodName
         AV                      = MFileManager->split(items[offset++], JAVA_BASE_PARSE_DIL);
         mMethod->methodName     = AV[1];
@@ -14,8 +14,11 @@ typedef struct {
     // terminate on fatal error
     void (*error_exit) (char* error_message);
 
-    // jdwp packet sender
+    // jdwp packet sender, queues the packet for the writer thread and never blocks
     void (*jdwpSend) (Packet* packet);
+
+    // while corked the writer holds queued packets, so a burst goes out in one write
+    void (*jdwpCork) (u1 corked);
 }
 HMainHandler;
 
@@ -24,7 +27,7 @@ typedef struct {
     u1* (*eventKind_to_cstr) (u1 eventKind);
     void (*dispatch_THREAD_START) (void);
     void (*dispatch_VM_INIT) (void);
-    void (*add) (EventRequest* event);
+    u1 (*add) (EventRequest* event); // FALSE if its location can't be patched
     void (*remove) (u1 eventKind, u4 requestID);
     void (*removeAllEventKind) (u1 eventKind);
     EventRequest* (*getByRequestID) (u4 requestID);
@@ -33,7 +36,16 @@ typedef struct {
     void (*holdEvents) (u1 holder);
     u1 (*canDispatchAll) (void);
     EventRequest* (*newEvent) (void);
-    void (*check_forEvents) (u1 scode, Cell* sp, Cell* fp, methodid_t method);
+    void (*check_forEvents) (u1* cp, Cell* sp, Cell* fp, methodid_t method);
+
+    // nonzero while check_forEvents can possibly suspend, read lock-free per opcode
+    volatile u1* armed;
+
+    // nonzero while any request is registered, vmCall then runs calls in vmCallDebug
+    volatile u1* active;
+
+    // called by the VM when it traps on a patched breakpoint
+    void (*breakpoint) (methodid_t method, u8 index);
 }
 HEventDispatcher;
 
@@ -48,15 +60,16 @@ typedef struct {
     RefTypeID* (*find_ByID) (referencetypeid_t rID);
     RefTypeID* (*find_BySignature) (u2* signature);
 
-    PacketList* (*methods_to_PacketList) (RefTypeID* clazz); // raw bytes
-    PacketList* (*fields_to_PacketList) (RefTypeID* clazz); // raw bytes
+    // complete replies (count + entries) for reply id, sized exactly
+    Packet* (*methods_to_Reply) (u4 id, RefTypeID* clazz);
+    Packet* (*fields_to_Reply) (u4 id, RefTypeID* clazz);
 
-    PacketList* (*fields_WithGeneric_to_PacketList) (RefTypeID* clazz); // raw bytes
-    PacketList* (*methods_WithGeneric_to_PacketList) (RefTypeID* clazz); // raw bytes
+    Packet* (*fields_WithGeneric_to_Reply) (u4 id, RefTypeID* clazz);
+    Packet* (*methods_WithGeneric_to_Reply) (u4 id, RefTypeID* clazz);
 
     size_t (*allClassesCount) (void);
-    PacketList* (*allClazzRefs_to_PacketList) (void);
-    PacketList* (*allClazzRefsWithGenetrics_to_PacketList) (void);
+    Packet* (*allClazzRefs_to_Reply) (u4 id);
+    Packet* (*allClazzRefsWithGenetrics_to_Reply) (u4 id);
 
     method* (*get_method) (referencetypeid_t rtid, methodid_t mid);
 
@@ -81,6 +94,7 @@ typedef struct {
     Packet* (*newPacketFromHeader) (u1* header);
     Packet* (*newPacketFromHeaderPayload) (u1* header, u1* payload);
     Packet* (*newRawPacket) (size_t rawbytes);
+    void (*release_Packet) (Packet* p); // back to the pool once sent
     u4 (*utf_csize) (u1* str);
     u4 (*utf_size) (u2* utf);
 
@@ -119,9 +133,15 @@ typedef struct {
     threadid_t (*read_threadid) (Packet* p);
     threadgroupid_t (*read_threadgroupid) (Packet* p);
     frameid_t (*read_frameid) (Packet* p);
-    Location* (*read_location) (Packet* p);
-    u1* (*read_str) (Packet* p);
-    u2* (*read_utf) (Packet* p);
+    void (*read_location) (Packet* p, Location* loc); // into loc, no allocation
+    u1* (*read_str) (Packet* p); // heap copy, caller frees
+    StrView (*read_strview) (Packet* p); // zero-copy, valid with the packet
+    u1* (*read_strArena) (Packet* p); // NUL terminated, valid until arena_reset
+    u2* (*read_utf) (Packet* p); // NUL terminated, valid until arena_reset
+
+    // per-command scratch memory of the JDWP thread
+    void* (*arena_alloc) (size_t bytes);
+    void (*arena_reset) (void);
 
     // basic byte writers
     void (*write_u1) (Packet* p, u1 u1);
@@ -154,6 +174,11 @@ typedef struct {
     u1 (*isPacketReply) (Packet* p);
     u1 (*isPacketCommand) (Packet* p);
 
+    // descriptor driven builder, see packetHandler.c for the field chars
+    size_t (*sizeof_fields) (const char* fields, ...);
+    void (*put_fields) (Packet* p, const char* fields, ...); // unchecked
+    Packet* (*newReplyOf) (u4 id, const char* fields, ...); // exact size
+
 }
 HPacketHandler;
 
@@ -216,6 +241,17 @@ typedef struct {
     Cell* (*invoke_Method) (methodid_t mid, Cell* args, int argc);
     u2 (*get_frameCount) (void);
     FrameContainer** (*getAllFrames) (void);
+
+    // patch/unpatch the Breakpoint trap at a code location, see vm.c
+    u1 (*set_breakpoint) (Location* loc);
+    void (*clear_breakpoint) (Location* loc);
+
+    // runs task on the VM thread at its next safepoint and waits for it,
+    // FALSE if the VM thread didn't get there in time and task didn't run
+    u1 (*at_safepoint) (void (*task) (void));
+
+    // wakes the VM thread if it is parked suspended
+    void (*wake) (void);
 }
 HVMHandler;
 
@@ -30,16 +30,19 @@
 #ifdef _WIN32
     #include <winsock.h>
     #include <io.h>
+    struct iovec { void* iov_base; size_t iov_len; };
 #else
     #include <sys/types.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <netdb.h>
     #include <arpa/inet.h>
     #include <unistd.h>
 #endif
 
-#define JDWP_INIT_WAIT 1                    // halt check delay
+#define OUT_IOV_MAX 64                      // packets per writev
 
 #define LOCAL_IP "127.0.0.1"                // output purpose "local" or "remote"
 #define PORT 8000                           // default JDWP
@@ -53,6 +56,7 @@
 #endif // LOG_PACKETS
 static void release_jdwpInitHalt();
 static void jdwpSend_error(u2 errorcode);
+static void runAtSafepoint(void (*task)(void));
 static void sleep(long s);
 static void close_socket();
 // special event handler, forwarded from vm code
@@ -66,6 +70,10 @@ static void error_exit(char* error_message);
 
 // jdwp packet sender
 static void jdwpSend(Packet* packet);
+static void jdwpCork(u1 corked);
+static void wakeWriter();
+static void* onWrite(void* arg);
+static void* onAccept(void* arg);
 
 // constants used in scope
 const static u1 THREAD_COUNT            = 4; // 3 here, 1 magic jni
@@ -95,9 +103,28 @@ const u1* __CS_VM_VERSION_vmName        = (u1*) "SedonaVM";
 
 // Internal vars
 static Packet* _MPacket;                        // pointer to oncommand recv packet
-static Packet* _PACKET_ERROR;                   // constant packet error var
+
+// receive buffer, unread bytes are [RECV_START, RECV_END)
+static u1* RECV_BUFF;
+static u4 RECV_CAP;
+static u4 RECV_START;
+static u4 RECV_END;
+static Packet RECV_PACKET;                      // _MPacket, framed in place over RECV_BUFF
 static pthread_t THREAD_RECV;                   // ref for thread start
+static pthread_t THREAD_SEND;                   // writer thread, see onWrite
+
+// outbound queue: producers push onto OUT_STACK with a CAS, the writer
+// takes the whole stack at once and reverses it into send order
+static Packet* volatile OUT_STACK = NULL;
+static volatile u4 OUT_CORKED     = 0;
+static pthread_mutex_t OUT_MUTEX  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  OUT_COND   = PTHREAD_COND_INITIALIZER;
 static volatile u1 init_jdwp;              // waiter till vm can be launched
+static volatile u1 attached_jdwp;          // IDE handshaked, until then jdwpSend drops packets
+static u1 wait_jdwp;                       // halt the VM until the IDE attached, see jdwp_setWaitForIde
+static pthread_t THREAD_ACCEPT;            // accepts the IDE while the VM already runs
+static pthread_mutex_t INIT_MUTEX = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  INIT_COND  = PTHREAD_COND_INITIALIZER; // signalled by release_jdwpInitHalt
 static threadid_t JDWP_TID              = 0; // thread id of jdwp
 static threadid_t JNI_TID               = 0;
 
@@ -182,14 +209,19 @@ inline static threadgroupid_t readthreadgroupid() {
     return PacketHandler->read_threadgroupid(_MPacket);
 }
 
-inline static Location* readlocation() {
-    return PacketHandler->read_location(_MPacket);
+inline static void readlocation(Location* loc) {
+    PacketHandler->read_location(_MPacket, loc);
 }
 
+// heap copy, only for strings kept past the command
 inline static u1* readstr() {
     return PacketHandler->read_str(_MPacket);
 }
 
+inline static StrView readstrview() {
+    return PacketHandler->read_strview(_MPacket);
+}
+
 inline static u2* readutf() {
     return PacketHandler->read_utf(_MPacket);
 }
@@ -198,6 +230,9 @@ inline static Packet* newReply(size_t bytes) {
     return PacketHandler->newReplyPacket(readid(), bytes);
 }
 
+// exact size reply from a field descriptor, see packetHandler.c
+#define newReplyOf(...) PacketHandler->newReplyOf(readid(), __VA_ARGS__)
+
 inline static void jdwpSend_Not_Implemented() {
     jdwpSend_error(NOT_IMPLEMENTED);
 }
@@ -208,19 +243,11 @@ inline static void jdwpSend_Not_Implemented() {
 inline static void onSend_CS_VM_Version() {
     printf("onSend_CS_VM_Version()\n");
 
-    size_t psize = string__SIZE(__CS_VM_VERSION_description) +
-                   (int__SIZE << 1) +
-                   string__SIZE(__CS_VM_VERSION_vmVersion) +
-                   string__SIZE(__CS_VM_VERSION_vmName);
-
-    Packet* p = newReply(psize);
-    PacketHandler->write_str(p, __CS_VM_VERSION_description);
-    PacketHandler->write_u4 (p, __CS_VM_VERSION_jdwpMajor);
-    PacketHandler->write_u4 (p, __CS_VM_VERSION_jdwpMinor);
-    PacketHandler->write_str(p, __CS_VM_VERSION_vmVersion);
-    PacketHandler->write_str(p, __CS_VM_VERSION_vmName);
-
-    jdwpSend(p);
+    jdwpSend(newReplyOf("SiiSS", __CS_VM_VERSION_description,
+                                 __CS_VM_VERSION_jdwpMajor,
+                                 __CS_VM_VERSION_jdwpMinor,
+                                 __CS_VM_VERSION_vmVersion,
+                                 __CS_VM_VERSION_vmName));
 }
 
 // Sends reference types for all the classes loaded by the target VM which match the given signature.
@@ -230,21 +257,25 @@ inline static void onSend_CS_VM_ClassesBySignature() { // I need to figure out i
     printf("onSend_CS_VM_ClassesBySignature()\n");
 
     Packet* p;
-    u1* signstr = readstr();
+    StrView sign = readstrview();
 
-    RefTypeID* typeID = RefHandler->find_BySignature(signstr);
+    // registry signatures are u2, widen into the command arena
+    u2* signature = (u2*) PacketHandler->arena_alloc((sign.length + 1) * sizeof(u2));
+    u4 start;
+    for(start = 0; start < sign.length; start++) {
+        signature[start] = sign.data[start];
+    }
+    signature[sign.length] = 0;
+
+    RefTypeID* typeID = RefHandler->find_BySignature(signature);
     if(typeID == NULL) {
-        printf("NOT found class = %s\n", signstr);
-        p = newReply(int__SIZE);
-        PacketHandler->write_u4(p, 0);
+        printf("NOT found class = %.*s\n", (int) sign.length, sign.data);
+        p = newReplyOf("i", 0);
     }
     else {
         printf("found class = %s, clazzid = %i\n", typeID->clazzname, typeID->ref_clazzid);
-        p = newReply(int__SIZE + byte__SIZE + referenceTypeID__SIZE + int__SIZE);
-        PacketHandler->write_u4(p, 1); // classes of signature
-        PacketHandler->write_tag(p, TYPETAG_CLASS); // no interfaces, just classes
-        PacketHandler->write_objectid(p, typeID->ref_clazzid);
-        PacketHandler->write_u4(p, typeID->status);
+        // classes of signature, no interfaces, just classes
+        p = newReplyOf("itoi", 1, TYPETAG_CLASS, typeID->ref_clazzid, typeID->status);
     }
 
     jdwpSend(p);
@@ -254,13 +285,7 @@ inline static void onSend_CS_VM_ClassesBySignature() { // I need to figure out i
 inline static void onSend_CS_VM_AllClasses() { // I need to figure out if this is needed first!
     printf("onSend_CS_VM_AllClasses()\n");
 
-    PacketList* clazzes = RefHandler->allClazzRefs_to_PacketList();
-    Packet* p = newReply(PacketHandler->get_ByteSize(clazzes) + int__SIZE);
-
-    PacketHandler->write_u4(p, clazzes->size);
-    PacketHandler->write_list(p, clazzes);
-
-    jdwpSend(p);
+    jdwpSend(RefHandler->allClazzRefs_to_Reply(readid()));
 }
 
 
@@ -305,14 +330,7 @@ inline static void onSend_CS_VM_IDSizes() { // Sends id sizes for fields, method
     printf("onSend_CS_VM_IDSizes()\n");
 
     // Order: fieldID, methodID, objectID, referenceTypeID, frameID
-    Packet* p = newReply(int__SIZE * 5);
-    PacketHandler->write_u4(p, fieldID__SIZE);
-    PacketHandler->write_u4(p, methodID__SIZE);
-    PacketHandler->write_u4(p, objectid__SIZE);
-    PacketHandler->write_u4(p, referenceTypeID__SIZE);
-    PacketHandler->write_u4(p, frameID__SIZE);
-
-    jdwpSend(p);
+    jdwpSend(newReplyOf("iiiii", fieldID__SIZE, methodID__SIZE, objectid__SIZE, referenceTypeID__SIZE, frameID__SIZE));
 }
 
 // Suspends the execution of the application running in the target VM
@@ -356,17 +374,14 @@ inline static void onSend_CS_VM_CreateString() {
 inline static void onSend_CS_VM_Capabilities() {
     printf("onSend_CS_VM_Capabilities()\n");
 
-    Packet* p = newReply(7);
-
-    PacketHandler->write_u1(p, FALSE); // canWatchFieldModification
-    PacketHandler->write_u1(p, FALSE); // canWatchFieldAccess
-    PacketHandler->write_u1(p, FALSE); // canGetBytecodes
-    PacketHandler->write_u1(p, TRUE); // canGetSyntheticAttribute
-    PacketHandler->write_u1(p, FALSE); // canGetOwnedMonitorInfo
-    PacketHandler->write_u1(p, FALSE); // canGetCurrentContendedMonitor
-    PacketHandler->write_u1(p, FALSE); // canGetMonitorInfo
-
-    jdwpSend(p);
+    jdwpSend(newReplyOf("bbbbbbb",
+        FALSE,  // canWatchFieldModification
+        FALSE,  // canWatchFieldAccess
+        FALSE,  // canGetBytecodes
+        TRUE,   // canGetSyntheticAttribute
+        FALSE,  // canGetOwnedMonitorInfo
+        FALSE,  // canGetCurrentContendedMonitor
+        FALSE)); // canGetMonitorInfo
 }
 
 // list of classpath, bootclasspath
@@ -463,13 +478,7 @@ inline static void onSend_CS_VM_SetDefaultStratum() {
 inline static void onSend_CS_VM_AllClassesWithGeneric() {
     printf("onSend_CS_VM_AllClassesWithGeneric()\n");
 
-    PacketList* clazzes = RefHandler->allClazzRefsWithGenetrics_to_PacketList();
-    Packet* p = newReply(PacketHandler->get_ByteSize(clazzes) + int__SIZE);
-
-    PacketHandler->write_u4(p, clazzes->size);
-    PacketHandler->write_list(p, clazzes);
-
-    jdwpSend(p);
+    jdwpSend(RefHandler->allClazzRefsWithGenetrics_to_Reply(readid()));
 }
 
 // Disabled by CapabilitiesNew
@@ -577,10 +586,7 @@ inline static void onSend_CS_RT_Signature() {
     RefTypeID* typeID = RefHandler->find_ByID(rtid);
 
     printf("found typeID = %s\n", typeID->clazzname);
-    Packet* p = newReply(PacketHandler->utf_size(typeID->signature));
-    PacketHandler->write_utf(p, typeID->signature);
-
-    jdwpSend(p);
+    jdwpSend(newReplyOf("U", typeID->signature));
 }
 
 inline static void onSend_CS_RT_ClassLoader() {
@@ -617,21 +623,8 @@ inline static void onSend_CS_RT_Fields() {
         return;
     }
 
-    Packet* p;
-    if(typeID->num_fields == 0) {
-        p = newReply(int__SIZE);
-        PacketHandler->write_u4(p, 0);
-    }
-    else {
-        // raw bytes
-        PacketList* fieldBytes = RefHandler->fields_to_PacketList(typeID);
-        // int num of declared fields
-        p = newReply(int__SIZE + PacketHandler->get_ByteSize(fieldBytes));
-        PacketHandler->write_u4(p, typeID->num_fields);
-        PacketHandler->write_list(p, fieldBytes);
-    }
-
-    jdwpSend(p);
+    // int num of declared fields + entries
+    jdwpSend(RefHandler->fields_to_Reply(readid(), typeID));
 }
 
 inline static void onSend_CS_RT_Methods() {
@@ -645,19 +638,7 @@ inline static void onSend_CS_RT_Methods() {
         return;
     }
 
-    Packet* p = NULL;
-    if(typeID->num_methods == 0) {
-        p = newReply(int__SIZE);
-        PacketHandler->write_u4(p, 0);
-    }
-    else {
-        PacketList* methodRawBytes = RefHandler->methods_to_PacketList(typeID);
-        p = newReply(int__SIZE + PacketHandler->get_ByteSize(methodRawBytes));
-        PacketHandler->write_u4(p, typeID->num_methods);
-        PacketHandler->write_list(p, methodRawBytes);
-    }
-
-    jdwpSend(p);
+    jdwpSend(RefHandler->methods_to_Reply(readid(), typeID));
 }
 
 inline static void onSend_CS_RT_Values() {
@@ -665,7 +646,7 @@ inline static void onSend_CS_RT_Values() {
 
     referencetypeid_t rtid  = readobjectid();
     u4 fields         = readu4();
-    fieldid_t* field_ids    = (fieldid_t*) malloc(fieldID__SIZE * fields);
+    fieldid_t* field_ids    = (fieldid_t*) PacketHandler->arena_alloc(sizeof(fieldid_t) * fields);
     u4 start          = 0;
 
     while(start++ < fields) {
@@ -744,13 +725,8 @@ inline static void onSend_CS_RT_SignatureWithGeneric() {
     referencetypeid_t rtid  = readobjectid();
     RefTypeID* typeID       = RefHandler->find_ByID(rtid);
 
-    Packet* p = newReply(PacketHandler->utf_size(typeID->signature) + int__SIZE);
-    PacketHandler->write_utf(p, typeID->signature);
-
-    // always assume there is no generic!
-    PacketHandler->write_u4(p, 0); // empty string | generic signature
-
-    jdwpSend(p);
+    // always assume there is no generic! empty string | generic signature
+    jdwpSend(newReplyOf("Ui", typeID->signature, 0));
 }
 
 inline static void onSend_CS_RT_FieldsWithGeneric() {
@@ -759,11 +735,7 @@ inline static void onSend_CS_RT_FieldsWithGeneric() {
     referencetypeid_t rtid  = readobjectid();
     RefTypeID* typeID       = RefHandler->find_ByID(rtid);
 
-    PacketList* pList = RefHandler->fields_WithGeneric_to_PacketList(typeID);
-    Packet* p  = newReply(PacketHandler->get_ByteSize(pList));
-    PacketHandler->write_list(p, pList);
-
-    jdwpSend(p);
+    jdwpSend(RefHandler->fields_WithGeneric_to_Reply(readid(), typeID));
 }
 
 inline static void onSend_CS_RT_MethodsWithGeneric() {
@@ -772,11 +744,7 @@ inline static void onSend_CS_RT_MethodsWithGeneric() {
     referencetypeid_t rtid  = readobjectid();
     RefTypeID* typeID       = RefHandler->find_ByID(rtid);
 
-    PacketList* pList = RefHandler->methods_WithGeneric_to_PacketList(typeID);
-    Packet* p  = newReply(PacketHandler->get_ByteSize(pList));
-    PacketHandler->write_list(p, pList);
-
-    jdwpSend(p);
+    jdwpSend(RefHandler->methods_WithGeneric_to_Reply(readid(), typeID));
 }
 
 inline static void onSend_CS_RT_Instances() {
@@ -789,11 +757,7 @@ inline static void onSend_CS_RT_Instances() {
 inline static void onSend_CS_RT_ClassFileVersion() {
     printf("onSend_CS_RT_ClassFileVersion\n");
 
-    Packet* p = newReply(int__SIZE << 1);
-    PacketHandler->write_u4(p, __CS_VM_VERSION_jdwpMajor);
-    PacketHandler->write_u4(p, __CS_VM_VERSION_jdwpMinor);
-
-    jdwpSend(p);
+    jdwpSend(newReplyOf("ii", __CS_VM_VERSION_jdwpMajor, __CS_VM_VERSION_jdwpMinor));
 }
 
 inline static void onSend_CS_RT_ConstantPool() {
@@ -1621,10 +1585,10 @@ static void onCSThreadReference() {
             onSend_CS_TR_ThreadGroup();
             break;
         case TRFrames:
-            onSend_CS_TR_Frames();
+            runAtSafepoint(onSend_CS_TR_Frames);
             break;
         case TRFrameCount:
-            onSend_CS_TR_FrameCount();
+            runAtSafepoint(onSend_CS_TR_FrameCount);
             break;
         case TROwnedMonitors:
             onSend_CS_TR_OwnedMonitors();
@@ -1874,8 +1838,16 @@ inline static void onSend_CS_ER_Set() {
     if(e->modCount > 0) {
         u4 modifiers_start = 0;
 
+        // EventRequest only has room for one modifier
+        if(e->modCount > 1) {
+            e = (EventRequest*) realloc(e, sizeof(EventRequest) + (e->modCount - 1) * sizeof(ModKind));
+        }
+
         while(modifiers_start < e->modCount) {
-            switch(readu1()) { // modKind u1 byte
+            u1 modKind = readu1();
+            e->mods[modifiers_start].modKind = modKind; // dispatcher matches on it
+
+            switch(modKind) {
                 case MODKIND_COUNT: { // 1
                     e->mods[modifiers_start].count.count = readu4();
                     printf("MODKIND_COUNT: count = %i\n", e->mods[modifiers_start].count.count);
@@ -1933,7 +1905,7 @@ inline static void onSend_CS_ER_Set() {
                     break;
                 }
                 case MODKIND_LocationOnly: { // 7
-                    e->mods[modifiers_start].locationOnly.loc = *readlocation();
+                    readlocation(&e->mods[modifiers_start].locationOnly.loc);
                     if(e->eventKind == BREAKPOINT) {
                         printf("MODKIND_LocationOnly: clazzid = %i, mid = %i, index = %i, tagID = %i\n",
                                e->mods[modifiers_start].locationOnly.loc.classID,
@@ -1992,8 +1964,11 @@ inline static void onSend_CS_ER_Set() {
         }
     }
 
-    if(e->isremoved == FALSE) {
-        EventHandler->add(e);
+    if(e->isremoved == FALSE && EventHandler->add(e) == FALSE) {
+        printf("Cannot set breakpoint: requestId = %i\n", e->requestId);
+        free(e);
+        jdwpSend_error(INVALID_LOCATION);
+        return;
     }
 
     Packet* p = newReply(int__SIZE);
@@ -2095,10 +2070,10 @@ inline static void onCommand() {
             onCSField();
             break;
         case CSObjectReference:
-            onCSObjectReference();
+            runAtSafepoint(onCSObjectReference); // reads VM state
             break;
         case CSStringReference:
-            onCSStringReference();
+            runAtSafepoint(onCSStringReference);
             break;
         case CSThreadReference:
             onCSThreadReference();
@@ -2107,7 +2082,7 @@ inline static void onCommand() {
             onCSThreadGroupReference();
             break;
         case CSArrayReference:
-            onCSArrayReference();
+            runAtSafepoint(onCSArrayReference);
             break;
         case CSClassLoaderReference:
             onCSClassLoaderReference();
@@ -2116,7 +2091,7 @@ inline static void onCommand() {
             onCSEventRequest();
             break;
         case CSStackFrame:
-            onCSStackFrame();
+            runAtSafepoint(onCSStackFrame);
             break;
         case CSClassObjectReference:
             onCSClassObjectReference();
@@ -2137,9 +2112,49 @@ inline static void onPacket() {
     }
 }
 
-inline static void readStream(u4 count, u1* mbuff) {
-    if(recv(_CLIENTSOCKET, mbuff, count, 0) <= 0) // -1 Error/Disconnected, 0 Remote Client closed connection
+// make room for at least count unread bytes, compacting before growing
+inline static void ensureRecvCap(u4 count) {
+    if(RECV_START > 0) {
+        memmove(RECV_BUFF, RECV_BUFF + RECV_START, RECV_END - RECV_START);
+        RECV_END -= RECV_START;
+        RECV_START = 0;
+    }
+
+    if(RECV_CAP < count) {
+        size_t cap = RECV_CAP;
+        while(cap < count) {
+            if(cap > (size_t) UINT32_MAX >> 1) { // doubling would not fit RECV_CAP anymore
+                cap = count;
+                break;
+            }
+            cap <<= 1;
+        }
+        RECV_BUFF = (u1*) realloc(RECV_BUFF, cap);
+        if(RECV_BUFF == NULL)
+            error_exit("[ensureRecvCap()] - Out of memory, SVM terminating...");
+        RECV_CAP = (u4) cap;
+    }
+}
+
+// blocks until the IDE sent something, then takes whatever the socket holds
+inline static void readStream() {
+    if(RECV_END == RECV_CAP) {
+        ensureRecvCap(RECV_END - RECV_START + 1);
+    }
+
+    int n = recv(_CLIENTSOCKET, RECV_BUFF + RECV_END, RECV_CAP - RECV_END, 0);
+    if(n <= 0) // -1 Error/Disconnected, 0 Remote Client closed connection
         error_exit("[readStream()] - IDE disconnected, SVM terminating...");
+
+    RECV_END += n;
+}
+
+// blocks until count unread bytes are buffered
+inline static void readStreamAtLeast(u4 count) {
+    ensureRecvCap(count);
+    while(RECV_END - RECV_START < count) {
+        readStream();
+    }
 }
 
 // implements extern functions
@@ -2147,42 +2162,44 @@ inline static u1 is_initedJDWP() { // returns jdwp init status, to break halter
     return init_jdwp;
 }
 
-// check mpayload cap
-inline static void ensurePayloadCap(u1* buff, u4* mbuff_size, u4 pLen) {
-    if(*mbuff_size < pLen) {
-        buff = (u1*) malloc(pLen - MIN_PACKET_SIZE);
-        *mbuff_size = pLen - MIN_PACKET_SIZE;
-    }
-}
-
 // OnReceive__CommandPacket Main Handler
+// Every recv takes as much as the socket holds; all complete packets in
+// the buffer are then handled back to back, in place, before reading again.
 inline static void onReceive() {
-    u4 mbuff_size     = 0; // let this by dynamic, rather than init value
-    u4 pLen           = 0;
-    u1* mheader       = (u1*) malloc(MIN_PACKET_SIZE);
-    u1* mpayload      = (u1*) malloc(mbuff_size);
+    u4 pLen;
 
+    _MPacket = &RECV_PACKET;
     release_jdwpInitHalt();
     while(TRUE) {
-        readStream(MIN_PACKET_SIZE, mheader);
+        while(RECV_END - RECV_START >= MIN_PACKET_SIZE) {
+            pLen = PacketHandler->read_u4_buff(RECV_BUFF + RECV_START + LENGTH_POS);
+
+            if(pLen < MIN_PACKET_SIZE || pLen > MAX_PACKET_SIZE) { // crap received <.< framing is lost, drop what we have
+                printf("[onReceive()] - Packet size Failure!\n");
+                RECV_PACKET.data = RECV_BUFF + RECV_START;
+                jdwpSend_error(SCHEMA_CHANGE_NOT_IMPLEMENTED);
+                RECV_START = RECV_END = 0;
+                break;
+            }
 
-        pLen = PacketHandler->read_u4_buff(mheader + LENGTH_POS);
-        ensurePayloadCap(mpayload, &mbuff_size, pLen);
+            if(RECV_END - RECV_START < pLen) { // rest of it is still on the wire
+                ensureRecvCap(pLen);
+                break;
+            }
 
-        if(pLen < MIN_PACKET_SIZE) { // crap received <.<
-            printf("[onReceive()] - Packet size Failure!\n");
-            jdwpSend_error(SCHEMA_CHANGE_NOT_IMPLEMENTED);
-            continue;
-        }
-        else if(pLen > MIN_PACKET_SIZE) { // read payload
-            readStream(pLen - MIN_PACKET_SIZE, mpayload);
-            _MPacket = PacketHandler->newPacketFromHeaderPayload(mheader, mpayload);
-        }
-        else {
-            _MPacket = PacketHandler->newPacketFromHeader(mheader);
+            RECV_PACKET.data   = RECV_BUFF + RECV_START;
+            RECV_PACKET.offset = DATA_VARIABLE_POS;
+            RECV_PACKET.length = pLen;
+            onPacket();
+            PacketHandler->arena_reset(); // views and arena memory die with the command
+
+            RECV_START += pLen;
         }
 
-        onPacket();
+        if(RECV_START == RECV_END) {
+            RECV_START = RECV_END = 0;
+        }
+        readStream();
     }
 }
 
@@ -2199,15 +2216,15 @@ inline static void onHandShake() {
     printf("####################################################\n");
     printf("[onHandShake()] - Waiting for ASCII Handshake = '%s'\n", HANDSHAKE_STR);
 
-    u1* hbuffer = (u1*) malloc(HANDSHAKE_SIZE);
-    readStream(HANDSHAKE_SIZE, hbuffer); // ASCII here
+    readStreamAtLeast(HANDSHAKE_SIZE); // ASCII here, the first commands may follow in the same read
 
     printf("[onHandShake()] - Handshake received, validating...\n");
 
-    if(strcmp(hbuffer, HANDSHAKE_STR) == 0) { // ensure the packet was HANDSHAKE_SIZE
+    if(memcmp(RECV_BUFF + RECV_START, HANDSHAKE_STR, HANDSHAKE_SIZE) == 0) {
         printf("[onHandShake()] - Handshake is valid, VM_DEBUG_MODE Active\n");
-        send(_CLIENTSOCKET, hbuffer, HANDSHAKE_SIZE, 0);
-        free(hbuffer);
+        send(_CLIENTSOCKET, HANDSHAKE_STR, HANDSHAKE_SIZE, 0);
+        RECV_START += HANDSHAKE_SIZE;
+        __atomic_store_n(&attached_jdwp, TRUE, __ATOMIC_RELEASE);
         EventHandler->dispatch_VM_INIT();
         onReceive();
     }
@@ -2277,17 +2294,23 @@ inline static void onHandShake() {
 inline static void release_jdwpInitHalt() {
     printf("----## Application execution halt released, application running ##----\n");
 
+    pthread_mutex_lock(&INIT_MUTEX);
     init_jdwp = TRUE; // declare VM as setup and release halt on main program executer
+    pthread_cond_broadcast(&INIT_COND);
+    pthread_mutex_unlock(&INIT_MUTEX);
 }
 
 inline static void jdwpSend_error(u2 errorcode) {
-    PacketHandler->write_errorcode(_PACKET_ERROR, errorcode);
-    PacketHandler->write_id(_PACKET_ERROR, readid());
-    send(_CLIENTSOCKET, _PACKET_ERROR->data, MIN_PACKET_SIZE, 0);
+    Packet* p = PacketHandler->newReplyPacket(readid(), 0);
+    PacketHandler->write_errorcode(p, errorcode);
+    jdwpSend(p);
+}
 
-    #ifdef LOG_PACKETS
-        logPacket(_PACKET_ERROR);
-    #endif
+// commands reading VM state run on the VM thread; one busy in a native
+// may not get there in time, its thread is not suspended then
+inline static void runAtSafepoint(void (*task)(void)) {
+    if(VMController->at_safepoint(task) == FALSE)
+        jdwpSend_error(THREAD_NOT_SUSPENDED);
 }
 
 inline static void error_exit(char* error_message) {
@@ -2306,13 +2329,17 @@ void init_mainHandler() {
     MHandler->onNullPointerException = onNullPointerException;
     MHandler->error_exit = error_exit;
     MHandler->jdwpSend = jdwpSend;
+    MHandler->jdwpCork = jdwpCork;
 
-    _PACKET_ERROR = PacketHandler->newReplyPacket(0, 0); // must be handler!
     init_jdwp = FALSE;
+    attached_jdwp = FALSE;
+
+    RECV_CAP   = 4096;
+    RECV_BUFF  = (u1*) malloc(RECV_CAP);
+    RECV_START = 0;
+    RECV_END   = 0;
 
     struct sockaddr_in server_addr;
-    struct sockaddr_in client_addr;
-    unsigned int clientaddrsize;
 
 #ifdef _WIN32
     WORD wVersionRequested;
@@ -2341,24 +2368,55 @@ void init_mainHandler() {
          error_exit("[init. JDWP()] - Listening for connections failed, SVM terminating...");
 
     printf("[init. JDWP()] - Listening on %s:%i - Waiting for IDE...\n", LOCAL_IP, PORT);
+    if(pthread_create(&THREAD_ACCEPT, NULL, &onAccept, NULL) != 0)
+        error_exit("[init. JDWP()] - Couldn't create accept thread, SVM terminating...");
+
+    if(wait_jdwp == FALSE) { // the IDE attaches to the running VM later on
+        printf("[init. JDWP()] - Not waiting for IDE, application running\n");
+        return;
+    }
+
+    pthread_mutex_lock(&INIT_MUTEX);
+    while(is_initedJDWP() == FALSE) { // halter, flows once IDE HandShaked
+        pthread_cond_wait(&INIT_COND, &INIT_MUTEX);
+    }
+    pthread_mutex_unlock(&INIT_MUTEX);
+}
+
+// Selects if init_mainHandler halts the VM until the IDE handshaked,
+// must be called before the VM is run. Default is to not wait.
+void jdwp_setWaitForIde(int wait) {
+    wait_jdwp = wait ? TRUE : FALSE;
+}
+
+// Accept thread, takes the IDE connection and then starts the writer
+// and the receive loop; the VM keeps running meanwhile
+static void* onAccept(void* arg) {
+    struct sockaddr_in client_addr;
+    unsigned int clientaddrsize;
+
     clientaddrsize = sizeof(client_addr);
     _CLIENTSOCKET = accept(_SERVERSOCKET, (struct sockaddr*)&client_addr, &clientaddrsize);
 
     if(_CLIENTSOCKET < 0)
         error_exit("[init. JDWP()] - Couldn't accept IDE incoming connection, SVM terminating...");
 
+    int nodelay = 1; // replies are small and latency bound
+    setsockopt(_CLIENTSOCKET, IPPROTO_TCP, TCP_NODELAY, (char*) &nodelay, sizeof(nodelay));
+
     char* client_ip = inet_ntoa(client_addr.sin_addr); // get client/ide ip address
     if(strncmp(client_ip, LOCAL_IP, sizeof(LOCAL_IP)) == 0) // check if is local or remote
         printf("[init. JDWP()] - IDE connected locally from IP: %s\n", client_ip);
     else
         printf("[init. JDWP()] - IDE connected from a #Remote# IP: %s\n", client_ip);
 
+    if(pthread_create(&THREAD_SEND, NULL, &onWrite, NULL) != 0)
+        error_exit("[init. JDWP()] - Couldn't create send thread, SVM terminating...");
+
     if(pthread_create(&THREAD_RECV, NULL, &onHandShake, NULL) != 0) // if thread creation failed
         error_exit("[init. JDWP()] - Couldn't create recieve loop into thread, SVM terminating...");
 
-    while(is_initedJDWP() == FALSE) { // halter, flows once IDE HandShaked
-        sleep(JDWP_INIT_WAIT);
-    }
+    return NULL;
 }
 
 // extern error handlers
@@ -2382,18 +2440,126 @@ inline static void onNullPointerException(int opcode, Cell* fp, Cell* sp) {
     EventHandler->dispatch(e);
 }
 
-// packet sender
+// packet sender, called from the VM and the JDWP thread
 inline static void jdwpSend(Packet* packet) {
-    PacketHandler->write_length(packet, packet->offset);
+    Packet* head;
+
+    if(__atomic_load_n(&attached_jdwp, __ATOMIC_ACQUIRE) == FALSE) { // no IDE to tell yet
+        PacketHandler->release_Packet(packet);
+        return;
+    }
 
-    send(_CLIENTSOCKET, packet->data, packet->offset, 0);
+    PacketHandler->write_length(packet, packet->offset);
 
     #ifdef LOG_PACKETS
         logPacket(packet);
     #endif
 
-    // lets free it
-    free(packet->data);
-    free(packet);
+    head = __atomic_load_n(&OUT_STACK, __ATOMIC_RELAXED);
+    do {
+        packet->next = head;
+    } while(!__atomic_compare_exchange_n(&OUT_STACK, &head, packet, TRUE, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if(head == NULL) { // writer may be waiting
+        wakeWriter();
+    }
+}
+
+inline static void wakeWriter() {
+    pthread_mutex_lock(&OUT_MUTEX);
+    pthread_cond_signal(&OUT_COND);
+    pthread_mutex_unlock(&OUT_MUTEX);
+}
+
+inline static void jdwpCork(u1 corked) {
+    if(corked) {
+        __atomic_add_fetch(&OUT_CORKED, 1, __ATOMIC_SEQ_CST);
+    }
+    else if(__atomic_sub_fetch(&OUT_CORKED, 1, __ATOMIC_SEQ_CST) == 0) {
+        wakeWriter();
+    }
+}
+
+inline static void setTcpCork(int on) {
+    #ifdef TCP_CORK
+        setsockopt(_CLIENTSOCKET, IPPROTO_TCP, TCP_CORK, (char*) &on, sizeof(on));
+    #endif
+}
+
+// writes all of iov, resuming after partial writes
+inline static void writeAll(struct iovec* iov, int n) {
+    while(n > 0) {
+        #ifdef _WIN32
+            int w = send(_CLIENTSOCKET, iov->iov_base, iov->iov_len, 0);
+        #else
+            ssize_t w = writev(_CLIENTSOCKET, iov, n);
+            if(w < 0 && errno == EINTR) {
+                continue;
+            }
+        #endif
+        if(w < 0) {
+            error_exit("[onWrite()] - IDE disconnected, SVM terminating...");
+        }
+
+        while(n > 0 && (size_t) w >= iov->iov_len) {
+            w -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if(n > 0) {
+            iov->iov_base = (u1*) iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+}
+
+// writer thread, the only one touching the socket after the handshake
+inline static void* onWrite(void* arg) {
+    struct iovec iov[OUT_IOV_MAX];
+    Packet* batch;
+    Packet* p;
+    Packet* next;
+    u1 corked;
+    int n;
+
+    while(TRUE) {
+        pthread_mutex_lock(&OUT_MUTEX);
+        while(OUT_STACK == NULL || OUT_CORKED > 0) {
+            pthread_cond_wait(&OUT_COND, &OUT_MUTEX);
+        }
+        pthread_mutex_unlock(&OUT_MUTEX);
+
+        p = __atomic_exchange_n(&OUT_STACK, NULL, __ATOMIC_ACQUIRE);
+        batch = NULL;
+        while(p != NULL) {
+            next = p->next;
+            p->next = batch;
+            batch = p;
+            p = next;
+        }
+
+        corked = batch->next != NULL;
+        if(corked) {
+            setTcpCork(TRUE);
+        }
+        while(batch != NULL) {
+            for(n = 0, p = batch; p != NULL && n < OUT_IOV_MAX; p = p->next, n++) {
+                iov[n].iov_base = p->data;
+                iov[n].iov_len  = p->offset;
+            }
+            writeAll(iov, n);
+
+            while(batch != p) {
+                next = batch->next;
+                PacketHandler->release_Packet(batch);
+                batch = next;
+            }
+        }
+        if(corked) {
+            setTcpCork(FALSE);
+        }
+    }
+
+    return NULL;
 }
 
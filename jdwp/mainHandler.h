@@ -1,7 +1,9 @@
 #ifndef _H_SS
 #define _H_SS
 
-// base halter for init. jdwp, this halts caller thread until IDE(debugger) is connected via a TCP connection
+// base init. of jdwp, listens for the IDE(debugger) and only halts the caller
+// thread until it connected if jdwp_setWaitForIde was set
 extern void init_mainHandler();
+extern void jdwp_setWaitForIde(int wait);
 
 #endif // _H_SS
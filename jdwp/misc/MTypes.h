@@ -23,6 +23,7 @@
 #define DATA_VARIABLE_POS 11                // offset (shared), length is computed on rest length size
 
 #define MIN_PACKET_SIZE 11                  // min size of a command packet
+#define MAX_PACKET_SIZE (16 * 1024 * 1024)  // max size of a command packet we buffer, bigger is taken as garbage
 
 // define id sizes, also unused are defined for now (Writing it all down)
 #define byte__SIZE 1                        // byte size                   (JDWP specific)
@@ -168,6 +169,8 @@ typedef struct {
     u8 endline;
 
     LineTable** lineTable;
+
+    u2 block; // scode method block, 0 if the method has no scode
 }
 method;
 
@@ -202,6 +205,11 @@ struct RefTypeID_s {
     struct RefTypeID_s** interfaces;
     field** fields;
     method** methods;
+
+    // methods by mid, built on first lookup, see get_method
+    method** methodIndex;
+    u2 methodIndexSize;
+    u2 methodIndexed; // num_methods when it was built
 };
 
 typedef struct RefTypeID_s RefTypeID;
@@ -215,6 +223,13 @@ typedef struct {
 }
 Location;
 
+// zero-copy view of a JDWP string inside a received packet, not NUL terminated
+typedef struct {
+    u4 length;
+    u1* data;
+}
+StrView;
+
 // Variable holder definition
 typedef struct {
     // JDWP assigned unique identifier
@@ -364,10 +379,12 @@ typedef struct {
 EventRequestList;
 
 // Defines cmd and reply packets
-typedef struct {
+typedef struct Packet_s {
     u1* data;
     size_t offset;
     size_t length; // yoloer
+
+    struct Packet_s* next; // send queue / packet pool link
 }
 Packet;
 
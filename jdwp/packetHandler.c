@@ -1,4 +1,7 @@
 #include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include "misc/MTypes.h"
 #include "initializer.h"
 
@@ -16,6 +19,33 @@ static volatile u4 PACKET_ID_UNIQUE          = 1;
 // Packet id gen Mutex
 static pthread_mutex_t MUTEX_T               = PTHREAD_MUTEX_INITIALIZER; // macro init.
 
+// sent packets are kept for reuse instead of freed, bounded by count and size
+#define PACKET_POOL_MAX       64
+#define PACKET_POOL_MAX_BYTES 65536
+
+static pthread_mutex_t POOL_MUTEX            = PTHREAD_MUTEX_INITIALIZER;
+static Packet* packetPool                    = NULL;
+static u4 packetPoolSize                     = 0;
+
+// Per-command arena, JDWP thread only. Everything taken from it is valid
+// until arena_reset(), which the server calls after each command. What
+// does not fit spills to the heap and the arena grows on reset, so a
+// pointer handed out is never moved.
+#define ARENA_INITIAL_BYTES   4096
+#define ARENA_ALIGN(n)        (((n) + 7) & ~((size_t) 7))
+
+typedef struct ArenaSpill_s {
+    struct ArenaSpill_s* next;
+    u8 align;
+}
+ArenaSpill;
+
+static u1* ARENA                             = NULL;
+static size_t ARENA_CAP                      = 0;
+static size_t ARENA_USED                     = 0;
+static size_t ARENA_SPILLED                  = 0;
+static ArenaSpill* ARENA_SPILL               = NULL;
+
 // forward internals
 static void sync_start();
 static void sync_end();
@@ -27,6 +57,7 @@ static Packet* newCommandPacket(size_t bytes, u1 command, u1 commandset);
 static Packet* newPacketFromHeader(u1* header);
 static Packet* newPacketFromHeaderPayload(u1* header, u1* payload);
 static Packet* newRawPacket(size_t rawbytes);
+static void release_Packet(Packet* p);
 
 // custom list functions
 static void add_Packet(Packet* p, PacketList* plist);
@@ -63,8 +94,11 @@ static objectid_t read_objectid(Packet* p);
 static threadid_t read_threadid(Packet* p);
 static threadgroupid_t read_threadgroupid(Packet* p);
 static frameid_t read_frameid(Packet* p);
-static Location* read_location(Packet* p);
+static void read_location(Packet* p, Location* loc);
+static u4 read_strlength(Packet* p);
 static u1* read_str(Packet* p);
+static StrView read_strview(Packet* p);
+static u1* read_strArena(Packet* p);
 
 // basic byte writers
 static void write_u1(Packet* p, u1 u1);
@@ -108,6 +142,15 @@ static u2* read_utf(Packet* p);
 
 static void ensurePacketCap(Packet* p, size_t mbytes);
 
+// per-command arena
+static void* arena_alloc(size_t bytes);
+static void arena_reset();
+
+// descriptor driven builder
+static size_t sizeof_fields(const char* fields, ...);
+static void put_fields(Packet* p, const char* fields, ...);
+static Packet* newReplyOf(u4 id, const char* fields, ...);
+
 inline static void sync_start() {
     if(pthread_mutex_lock(&MUTEX_T) != 0) // must return 0, to tell we own the lock
         MHandler->error_exit("Fatal Error at generating new Packet ID! Mutex could not be locked!");
@@ -129,7 +172,7 @@ inline static u4 gen_packetID() {
 }
 
 inline static void ensurePacketCap(Packet* p, size_t mbytes) {
-    if(p->offset + mbytes >= p->length) {
+    if(p->offset + mbytes > p->length) {
         size_t newmsize = mbytes + (p->length << 1);
         p->data = (u1*) realloc(p->data, newmsize);
         p->length = newmsize;
@@ -140,15 +183,63 @@ inline static void ensurePacketCap(Packet* p, size_t mbytes) {
     }
 }
 
+inline static void* arena_alloc(size_t bytes) {
+    bytes = ARENA_ALIGN(bytes);
+
+    if(ARENA_USED + bytes <= ARENA_CAP) {
+        void* m = ARENA + ARENA_USED;
+        ARENA_USED += bytes;
+        return m;
+    }
+
+    ArenaSpill* s = (ArenaSpill*) malloc(sizeof(ArenaSpill) + bytes);
+    if(s == NULL) {
+        MHandler->error_exit("failed allocating arena bytes");
+    }
+
+    s->next = ARENA_SPILL;
+    ARENA_SPILL = s;
+    ARENA_SPILLED += bytes;
+    return s + 1;
+}
+
+inline static void arena_reset() {
+    if(ARENA_SPILL != NULL) {
+        size_t need = ARENA_USED + ARENA_SPILLED;
+
+        while(ARENA_SPILL != NULL) {
+            ArenaSpill* next = ARENA_SPILL->next;
+            free(ARENA_SPILL);
+            ARENA_SPILL = next;
+        }
+
+        if(need < ARENA_INITIAL_BYTES) {
+            need = ARENA_INITIAL_BYTES;
+        }
+        if(need > ARENA_CAP) {
+            free(ARENA);
+            ARENA = (u1*) malloc(need);
+            ARENA_CAP = ARENA == NULL ? 0 : need;
+        }
+        ARENA_SPILLED = 0;
+    }
+
+    ARENA_USED = 0;
+}
+
 void init_packetHandler() {
     int mret;
     mret = pthread_mutex_init(&MUTEX_T, NULL);
 
+    ARENA = (u1*) malloc(ARENA_INITIAL_BYTES);
+    ARENA_CAP = ARENA == NULL ? 0 : ARENA_INITIAL_BYTES;
+
     PacketHandler->newReplyPacket = newReplyPacket;
     PacketHandler->newCommandPacket = newCommandPacket;
     PacketHandler->newPacketFromHeader = newPacketFromHeader;
     PacketHandler->newPacketFromHeaderPayload = newPacketFromHeaderPayload;
     PacketHandler->newRawPacket = newRawPacket;
+    PacketHandler->release_Packet = release_Packet;
 
     // custom list functions
     PacketHandler->add_Packet = add_Packet;
@@ -187,6 +278,8 @@ void init_packetHandler() {
     PacketHandler->read_frameid = read_frameid;
     PacketHandler->read_location = read_location;
     PacketHandler->read_str = read_str;
+    PacketHandler->read_strview = read_strview;
+    PacketHandler->read_strArena = read_strArena;
 
     // basic byte writers
     PacketHandler->write_u1 = write_u1;
@@ -222,6 +315,13 @@ void init_packetHandler() {
     PacketHandler->write_utf = write_utf;
     PacketHandler->write_cutf = write_cutf;
     PacketHandler->read_utf = read_utf;
+
+    PacketHandler->arena_alloc = arena_alloc;
+    PacketHandler->arena_reset = arena_reset;
+
+    PacketHandler->sizeof_fields = sizeof_fields;
+    PacketHandler->put_fields = put_fields;
+    PacketHandler->newReplyOf = newReplyOf;
 }
 
 inline static u2 read_u2_buff(u1* buff) {
@@ -232,7 +332,7 @@ inline static u2 read_u2_buff(u1* buff) {
 }
 
 inline static u4 read_u4_buff(u1* buff) {
-    u4 i = *(buff + 0) << 24;
+    u4 i = (u4) *(buff + 0) << 24;
     i |= *(buff + 1) << 16;
     i |= *(buff + 2)  << 8;
     i |= *(buff + 3);
@@ -241,14 +341,8 @@ inline static u4 read_u4_buff(u1* buff) {
 }
 
 inline static u8 read_u8_buff(u1* buff) {
-    u8 i = *(buff + 0) << 56;
-    i |= *(buff + 1) << 48;
-    i |= *(buff + 2) << 40;
-    i |= *(buff + 3) << 32;
-    i |= *(buff + 4) << 24;
-    i |= *(buff + 5) << 16;
-    i |= *(buff + 6)  << 8;
-    i |= *(buff + 7);
+    u8 i = (u8) read_u4_buff(buff) << 32;
+    i |= read_u4_buff(buff + 4);
 
     return i;
 }
@@ -387,29 +481,50 @@ inline static frameid_t read_frameid(Packet* p) {
     #endif
 }
 
-inline static Location* read_location(Packet* p) {
-    Location* loc   = (Location*) malloc(sizeof(Location));
-
+// decodes into the caller's storage, nothing allocated
+inline static void read_location(Packet* p, Location* loc) {
     loc->tag        = read_tag(p);
     loc->classID    = read_objectid(p);
     loc->methodID   = read_methodid(p);
 
     loc->index      = read_u8(p);
+}
 
-    return loc;
+// a string length from the wire, clamped to what is left in the packet
+inline static u4 read_strlength(Packet* p) {
+    u4 len  = read_u4(p);
+    u4 rest = p->offset < p->length ? p->length - p->offset : 0;
+    return len < rest ? len : rest;
 }
 
+// heap copy the caller owns, for strings that outlive the command
 inline static u1* read_str(Packet* p) {
-    u4 len = read_u4(p);
+    u4 len = read_strlength(p);
 
     u1* str = (u1*) malloc(len + 1);
-    size_t start = 0;
+    memcpy(str, p->data + p->offset, len);
+    p->offset += len;
 
-    while(start < len) {
-        str[start++] = read_u1(p);
-    }
+    str[len] = '\0'; // must be null terminated!
+    return str;
+}
 
-    str[start] = '\0'; // must be null terminated!
+// points into the packet, valid while the packet is
+inline static StrView read_strview(Packet* p) {
+    StrView v;
+    v.length = read_strlength(p);
+    v.data   = p->data + p->offset;
+    p->offset += v.length;
+    return v;
+}
+
+// NUL terminated copy in the command arena
+inline static u1* read_strArena(Packet* p) {
+    StrView v = read_strview(p);
+
+    u1* str = (u1*) arena_alloc(v.length + 1);
+    memcpy(str, v.data, v.length);
+    str[v.length] = '\0';
     return str;
 }
 
@@ -681,10 +796,188 @@ inline static void write_cutf(Packet* p, u1* str) {
     }
 }
 
+// Field descriptors, one char per field, for sizeof_fields, put_fields and newReplyOf:
+//   'b' u1    's' u2    'i' u4    'l' u8    't' tag
+//   'o' objectid / referencetypeid    'T' threadid    'G' threadgroupid
+//   'm' methodid    'f' fieldid    'F' frameid    'L' Location*
+//   'S' u1* string (as write_str)    'C' u1* cutf    'U' u2* utf
+// The size pass and the store pass walk the same descriptor, so a reply
+// built from it is allocated once at its exact size and encoded without
+// capacity checks.
+
+// ids and u4 arrive as u4, ids configured to 8 bytes as u8
+#define va_field(ap, size) ((size) == long__SIZE ? va_arg(ap, u8) : (u8) va_arg(ap, u4))
+
+// unchecked big endian stores, the caller reserved the bytes
+inline static u1* put_be(u1* d, u8 v, size_t size) {
+    switch(size) {
+        case long__SIZE:
+            *d++ = v >> 56;
+            *d++ = v >> 48;
+            *d++ = v >> 40;
+            *d++ = v >> 32;
+        case int__SIZE:
+            *d++ = v >> 24;
+            *d++ = v >> 16;
+        case short__SIZE:
+            *d++ = v >> 8;
+        default:
+            *d++ = v & 0xff;
+    }
+    return d;
+}
+
+inline static u1* put_utf(u1* d, u2* utf) {
+    u1* len = d;
+    d += int__SIZE;
+
+    u2 u2Char;
+    while(*utf != NULL) {
+        u2Char = *utf++;
+
+        if(u2Char > 0 && u2Char <= 127) {
+            *d++ = u2Char;
+        }
+        else if(u2Char <= 2047) {
+            *d++ = (0xc0 | (0x1f & (u2Char >> 6))) & 0xff;
+            *d++ = (0x80 | (0x3f & u2Char))        & 0xff;
+        }
+        else {
+            *d++ = (0xe0 | (0x0f & (u2Char >> 12))) & 0xff;
+            *d++ = (0x80 | (0x3f & (u2Char >> 6 ))) & 0xff;
+            *d++ = (0x80 | (0x3f & (u2Char      ))) & 0xff;
+        }
+    }
+
+    put_be(len, d - len - int__SIZE, int__SIZE);
+    return d;
+}
+
+inline static u1* put_cutf(u1* d, u1* str) {
+    u1* len = d;
+    d += int__SIZE;
+
+    u2 u2Char;
+    while(*str != NULL) {
+        u2Char = (u2) *str++;
+
+        if(u2Char > 0 && u2Char <= 127) {
+            *d++ = u2Char;
+        }
+        else {
+            *d++ = (0xc0 | (0x1f & (u2Char >> 6))) & 0xff;
+            *d++ = (0x80 | (0x3f & u2Char))        & 0xff;
+        }
+    }
+
+    put_be(len, d - len - int__SIZE, int__SIZE);
+    return d;
+}
+
+inline static size_t vsizeof_fields(const char* fields, va_list ap) {
+    size_t bytes = 0;
+
+    while(*fields) {
+        switch(*fields++) {
+            case 'b': va_arg(ap, u4); bytes += byte__SIZE; break;
+            case 's': va_arg(ap, u4); bytes += short__SIZE; break;
+            case 'i': va_arg(ap, u4); bytes += int__SIZE; break;
+            case 'l': va_arg(ap, u8); bytes += long__SIZE; break;
+            case 't': va_field(ap, tag__SIZE); bytes += tag__SIZE; break;
+            case 'o': va_field(ap, objectid__SIZE); bytes += objectid__SIZE; break;
+            case 'T': va_field(ap, threadid__SIZE); bytes += threadid__SIZE; break;
+            case 'G': va_field(ap, threadGroupID__SIZE); bytes += threadGroupID__SIZE; break;
+            case 'm': va_field(ap, methodID__SIZE); bytes += methodID__SIZE; break;
+            case 'f': va_field(ap, fieldID__SIZE); bytes += fieldID__SIZE; break;
+            case 'F': va_field(ap, frameID__SIZE); bytes += frameID__SIZE; break;
+            case 'L': va_arg(ap, Location*); bytes += location__SIZE; break;
+            case 'S': bytes += string__SIZE(va_arg(ap, u1*)); break;
+            case 'C': bytes += utf_csize(va_arg(ap, u1*)); break;
+            case 'U': bytes += utf_size(va_arg(ap, u2*)); break;
+            default:
+                MHandler->error_exit("unknown packet field descriptor");
+        }
+    }
+
+    return bytes;
+}
+
+inline static void vput_fields(Packet* p, const char* fields, va_list ap) {
+    u1* d = p->data + p->offset;
+    Location* loc;
+    u1* str;
+
+    while(*fields) {
+        switch(*fields++) {
+            case 'b': *d++ = (u1) va_arg(ap, u4); break;
+            case 's': d = put_be(d, va_arg(ap, u4), short__SIZE); break;
+            case 'i': d = put_be(d, va_arg(ap, u4), int__SIZE); break;
+            case 'l': d = put_be(d, va_arg(ap, u8), long__SIZE); break;
+            case 't': d = put_be(d, va_field(ap, tag__SIZE), tag__SIZE); break;
+            case 'o': d = put_be(d, va_field(ap, objectid__SIZE), objectid__SIZE); break;
+            case 'T': d = put_be(d, va_field(ap, threadid__SIZE), threadid__SIZE); break;
+            case 'G': d = put_be(d, va_field(ap, threadGroupID__SIZE), threadGroupID__SIZE); break;
+            case 'm': d = put_be(d, va_field(ap, methodID__SIZE), methodID__SIZE); break;
+            case 'f': d = put_be(d, va_field(ap, fieldID__SIZE), fieldID__SIZE); break;
+            case 'F': d = put_be(d, va_field(ap, frameID__SIZE), frameID__SIZE); break;
+            case 'L':
+                loc = va_arg(ap, Location*);
+                d = put_be(d, loc->tag, tag__SIZE);
+                d = put_be(d, loc->classID, classID__SIZE);
+                d = put_be(d, loc->methodID, methodID__SIZE);
+                d = put_be(d, loc->index, long__SIZE);
+                break;
+            case 'S':
+                str = va_arg(ap, u1*);
+                d = put_be(d, strlen(str) * char__SIZE, int__SIZE);
+                while(*str) {
+                    d = put_be(d, *str++, char__SIZE);
+                }
+                break;
+            case 'C': d = put_cutf(d, va_arg(ap, u1*)); break;
+            case 'U': d = put_utf(d, va_arg(ap, u2*)); break;
+        }
+    }
+
+    p->offset = d - p->data;
+}
+
+// bytes the fields take on the wire
+inline static size_t sizeof_fields(const char* fields, ...) {
+    va_list ap;
+    va_start(ap, fields);
+    size_t bytes = vsizeof_fields(fields, ap);
+    va_end(ap);
+    return bytes;
+}
+
+// no capacity check, reserve sizeof_fields bytes up front
+inline static void put_fields(Packet* p, const char* fields, ...) {
+    va_list ap;
+    va_start(ap, fields);
+    vput_fields(p, fields, ap);
+    va_end(ap);
+}
+
+// reply holding exactly the given fields, one allocation
+inline static Packet* newReplyOf(u4 id, const char* fields, ...) {
+    va_list ap, sizing;
+    va_start(ap, fields);
+    va_copy(sizing, ap);
+
+    Packet* p = newReplyPacket(id, vsizeof_fields(fields, sizing));
+    vput_fields(p, fields, ap);
+
+    va_end(sizing);
+    va_end(ap);
+    return p;
+}
+
+// NUL terminated, lives in the command arena
 inline static u2* read_utf(Packet* p) {
     u4 utfCount = read_u4(p);
     size_t utfStart = 0;
-    u2* outstr = (u2*) malloc(sizeof(u2) * utfCount / 3 * 2);
+    u2* outstr = (u2*) arena_alloc(sizeof(u2) * (utfCount + 1)); // never more chars than bytes
     size_t i = 0;
 
     u2 u2Char_1;
@@ -728,6 +1021,7 @@ inline static u2* read_utf(Packet* p) {
         }
     }
 
+    outstr[i] = 0;
     return outstr;
 }
 
@@ -819,10 +1113,7 @@ inline static void write_packet(Packet* to, Packet* from) {
         to->length = to->offset; // wrap
     }
 
-    while(from->offset >= to->length - to->offset) {
-        to->data = (u1*) realloc(to->data, to->length << 1);
-        to->length <<= 1;
-    }
+    ensurePacketCap(to, from->offset);
     memcpy(to->data + to->offset, from->data, from->offset);
     to->offset += from->offset;
 }
@@ -857,12 +1148,52 @@ inline static Packet* newPacketFromHeaderPayload(u1* header, u1* payload) {
     return p;
 }
 
+// length is the buffer capacity, pooled packets may come back larger than asked
 inline static Packet* newRawPacket(size_t rawbytes) {
-    Packet* p = (Packet*) malloc(sizeof(Packet));
-    p->data = (u1*) malloc(rawbytes);
-    p->offset = 0;
-    p->length = rawbytes;
+    Packet* p;
+
+    pthread_mutex_lock(&POOL_MUTEX);
+    p = packetPool;
+    if(p != NULL) {
+        packetPool = p->next;
+        packetPoolSize--;
+    }
+    pthread_mutex_unlock(&POOL_MUTEX);
+
+    if(p == NULL) {
+        p = (Packet*) malloc(sizeof(Packet));
+        p->data = (u1*) malloc(rawbytes);
+        p->length = rawbytes;
+    }
+    else if(p->length < rawbytes) {
+        p->data = (u1*) realloc(p->data, rawbytes);
+        p->length = rawbytes;
+    }
 
+    if(p->data == NULL) {
+        MHandler->error_exit("failed allocating packet bytes");
+    }
+
+    p->offset = 0;
+    p->next = NULL;
     return p;
 }
 
+inline static void release_Packet(Packet* p) {
+    if(p->length <= PACKET_POOL_MAX_BYTES) {
+        pthread_mutex_lock(&POOL_MUTEX);
+        if(packetPoolSize < PACKET_POOL_MAX) {
+            p->next = packetPool;
+            packetPool = p;
+            packetPoolSize++;
+            p = NULL;
+        }
+        pthread_mutex_unlock(&POOL_MUTEX);
+    }
+
+    if(p != NULL) {
+        free(p->data);
+        free(p);
+    }
+}
+
@@ -21,11 +21,44 @@
 #define Array "["
 #define object "Ljava/lang/Object"
 
+// reply entry layouts, the generic variants carry an empty generic signature
+#define CLASS_FIELDS            "boUi"
+#define CLASS_GENERIC_FIELDS    "boUii"
+#define METHOD_FIELDS           "mSUi"
+#define METHOD_GENERIC_FIELDS   "mSUii"
+#define FIELD_FIELDS            "fSUi"
+#define FIELD_GENERIC_FIELDS    "fSUii"
+
+#define REF_INDEX_INITIAL 64                // slots, power of two
+
 // counter
 static volatile objectid_t _OID;
 static refTypeID_list* refList;
 static RefTypeID* startRef;
 
+// Lookup indexes over refList. Names and signatures hash into open
+// addressed tables (linear probing, kept at most half full); reference
+// ids are handed out densely from _OID, so they index an array directly.
+// A later registration under the same key shadows the earlier one, as
+// the head-first list walk did.
+typedef struct {
+    size_t hash;
+    RefTypeID* ref;
+}
+RefSlot;
+
+typedef struct {
+    RefSlot* slots;
+    size_t mask;                            // capacity - 1
+    size_t size;
+}
+RefIndex;
+
+static RefIndex refsByName;
+static RefIndex refsBySign;
+static RefTypeID** refsByRid;
+static size_t refsByRidCap;
+
 // internal forwards
 static RefTypeID* findref_Byclassname(u1* cname);
 static RefTypeID* findref_Bysign(u2* sign);
@@ -35,20 +68,14 @@ static u2* mk_class_sign(u1* clazzname);
 static u2* mk_array_sign(u1* clazzname);
 static u2* mku2(u1* str);
 
-static Packet* method_bytes(method* m);
-static Packet* methodWithGeneric_bytes(method* m);
-
-static PacketList* methods_to_PacketList(RefTypeID* typeID);
-static PacketList* methodsWithGeneric_to_PacketList(RefTypeID* typeID);
+static Packet* methods_to_Reply(u4 id, RefTypeID* typeID);
+static Packet* methodsWithGeneric_to_Reply(u4 id, RefTypeID* typeID);
 
-static Packet* field_bytes(field* f);
-static Packet* fieldWithGeneric_bytes(field* f);
+static Packet* fields_to_Reply(u4 id, RefTypeID* typeID);
+static Packet* fieldsWithGeneric_to_Reply(u4 id, RefTypeID* typeID);
 
-static PacketList* fields_to_PacketList(RefTypeID* typeID);
-static PacketList* fieldsWithGeneric_to_PacketList(RefTypeID* typeID);
-
-static PacketList* allClassesRefsWithGenerics_to_PacketList();
-static PacketList* allClassesRefs_to_PacketList();
+static Packet* allClassesRefsWithGenerics_to_Reply(u4 id);
+static Packet* allClassesRefs_to_Reply(u4 id);
 static size_t allClassesRefsCount();
 
 static RefTypeID* add_ClassRef(u1* clazzname, RefTypeID* superclass);
@@ -66,22 +93,48 @@ static void setStartClassRef(RefTypeID* ref);
 static RefTypeID* getStartRef();
 
 static void add_RefTypeID(RefTypeID* typeID);
+static void index_ref(RefTypeID* typeID);
 static void add_Inner_Classes_Stared_Of(RefTypeID* of);
 
-inline static method* get_method(referencetypeid_t rtid, methodid_t mid) {
-    RefTypeID* typeID = findref_Byrid(rtid);
-
+// the first method declaring a mid owns it, as the linear scan had it
+inline static void index_methods(RefTypeID* typeID) {
     u2 mcount = typeID->num_methods;
-    u2 start = 0;
+    u4 size = 0;
+    u2 start;
 
-    while(start < mcount) {
-        if(typeID->methods[start]->mid == mid) {
-            return typeID->methods[start];
+    for(start = 0; start < mcount; start++) {
+        if(typeID->methods[start]->mid >= size) {
+            size = typeID->methods[start]->mid + 1;
         }
-        start++;
     }
 
-    return NULL;
+    free(typeID->methodIndex);
+    typeID->methodIndex = (method**) calloc(size > 0 ? size : 1, sizeof(method*));
+    if(typeID->methodIndex == NULL) {
+        MHandler->error_exit("failed allocating method index!");
+    }
+
+    start = mcount;
+    while(start-- > 0) {
+        typeID->methodIndex[typeID->methods[start]->mid] = typeID->methods[start];
+    }
+
+    typeID->methodIndexSize = size;
+    typeID->methodIndexed   = mcount;
+}
+
+inline static method* get_method(referencetypeid_t rtid, methodid_t mid) {
+    RefTypeID* typeID = findref_Byrid(rtid);
+    if(typeID == NULL) {
+        return NULL;
+    }
+
+    // methods may be added, or assigned directly, after the last lookup
+    if(typeID->methodIndex == NULL || typeID->methodIndexed != typeID->num_methods) {
+        index_methods(typeID);
+    }
+
+    return mid < typeID->methodIndexSize ? typeID->methodIndex[mid] : NULL;
 }
 
 
@@ -164,182 +217,120 @@ inline static size_t allClassesRefsCount() {
     return refList->size;
 }
 
-inline static PacketList* allClassesRefsWithGenerics_to_PacketList() {
+// Every list reply is built in two passes over the same descriptor:
+// size all entries, allocate the reply once, then store them unchecked.
+inline static Packet* classes_to_Reply(u4 id, u1 generic) {
     refTypeIDBuff* cur = refList->head;
     size_t lsize = refList->size;
+    size_t bytes = int__SIZE;
     size_t start = 0;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
-    Packet* p = NULL;
-
-    while(start < lsize) {
-        p = PacketHandler->newRawPacket(byte__SIZE + int__SIZE + referenceTypeID__SIZE + PacketHandler->utf_size(cur->reftypeid->signature) + int__SIZE);
+    RefTypeID* t;
 
-        PacketHandler->write_u1(p, cur->reftypeid->typeTag);
-        PacketHandler->write_objectid(p, cur->reftypeid->ref_clazzid);
-        PacketHandler->write_utf(p, cur->reftypeid->signature);
-        PacketHandler->write_u4(p, 0); // none gen str, so 0 byte it
-        PacketHandler->write_u4(p, cur->reftypeid->status);
+    while(start++ < lsize) {
+        t = cur->reftypeid;
+        bytes += generic ? PacketHandler->sizeof_fields(CLASS_GENERIC_FIELDS, t->typeTag, t->ref_clazzid, t->signature, 0, t->status)
+                         : PacketHandler->sizeof_fields(CLASS_FIELDS, t->typeTag, t->ref_clazzid, t->signature, t->status);
+        cur = cur->next;
+    }
 
-        PacketHandler->add_Packet(p, pList);
+    Packet* p = PacketHandler->newReplyPacket(id, bytes);
+    PacketHandler->put_fields(p, "i", (u4) lsize);
 
+    cur = refList->head;
+    start = 0;
+    while(start++ < lsize) {
+        t = cur->reftypeid;
+        if(generic) {
+            PacketHandler->put_fields(p, CLASS_GENERIC_FIELDS, t->typeTag, t->ref_clazzid, t->signature, 0, t->status);
+        }
+        else {
+            PacketHandler->put_fields(p, CLASS_FIELDS, t->typeTag, t->ref_clazzid, t->signature, t->status);
+        }
         cur = cur->next;
-        start++;
     }
 
-    return pList;
+    return p;
 }
 
-inline static PacketList* allClassesRefs_to_PacketList() {
-    refTypeIDBuff* cur = refList->head;
-    size_t lsize = refList->size;
-    size_t start = 0;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
-    Packet* p = NULL;
-
-    while(start < lsize) {
-        p = PacketHandler->newRawPacket(byte__SIZE + int__SIZE + referenceTypeID__SIZE + PacketHandler->utf_size(cur->reftypeid->signature));
-
-        PacketHandler->write_u1(p, cur->reftypeid->typeTag);
-        PacketHandler->write_objectid(p, cur->reftypeid->ref_clazzid);
-        PacketHandler->write_utf(p, cur->reftypeid->signature);
-        PacketHandler->write_u4(p, cur->reftypeid->status);
-
-        PacketHandler->add_Packet(p, pList);
+inline static Packet* allClassesRefsWithGenerics_to_Reply(u4 id) {
+    return classes_to_Reply(id, TRUE);
+}
 
-        cur = cur->next;
-        start++;
-    }
-    printf("YOLOER");
-    return pList;
+inline static Packet* allClassesRefs_to_Reply(u4 id) {
+    return classes_to_Reply(id, FALSE);
 }
 
-inline static PacketList* methodsWithGeneric_to_PacketList(RefTypeID* typeID) {
+inline static Packet* methodList_to_Reply(u4 id, RefTypeID* typeID, u1 generic) {
     u2 num_methods = typeID->num_methods; // 2 bytes method count is enough i guess!
-
     method** m = typeID->methods;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
+    size_t bytes = int__SIZE;
+    u2 start;
 
-    u2 start = 0;
-    while(start < num_methods) {
-        PacketHandler->add_Packet(methodWithGeneric_bytes(m[start]), pList);
-        start++;
+    for(start = 0; start < num_methods; start++) {
+        bytes += PacketHandler->sizeof_fields(METHOD_FIELDS, m[start]->mid, m[start]->methodName, m[start]->methodJNISignature, m[start]->modBits);
     }
-
-    return pList;
-}
-
-inline static Packet* methodWithGeneric_bytes(method* m) {
-    size_t psize = methodID__SIZE + int__SIZE;
-    psize += string__SIZE(m->methodName);
-    psize += PacketHandler->utf_size(m->methodJNISignature);
-    psize += int__SIZE;
-
-    Packet* p = PacketHandler->newRawPacket(psize);
-
-    PacketHandler->write_methodid(p, m->mid);
-    PacketHandler->write_str(p, m->methodName); // assume all methods are non-compile generated?
-    PacketHandler->write_utf(p, m->methodJNISignature);
-    PacketHandler->write_u4(p, 0);
-    PacketHandler->write_u4(p, m->modBits);
-
-    return p;
-}
-
-inline static PacketList* fieldsWithGeneric_to_PacketList(RefTypeID* typeID) {
-    u2 num_fields = typeID->num_fields; // 2 bytes method count is enough i guess!
-
-    field** f = typeID->fields;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
-
-    u2 start = 0;
-    while(start < num_fields) {
-        PacketHandler->add_Packet(fieldWithGeneric_bytes(f[start]), pList);
-        start++;
+    if(generic) {
+        bytes += num_methods * int__SIZE;
     }
 
-    return pList;
-}
-
-inline static Packet* fieldWithGeneric_bytes(field* f) {
-    size_t psize = fieldID__SIZE + int__SIZE;
-    psize += string__SIZE(f->fieldName);
-    psize += PacketHandler->utf_size(f->fieldJNIsignature);
-    psize += int__SIZE;
-
-    Packet* p = PacketHandler->newRawPacket(psize);
+    Packet* p = PacketHandler->newReplyPacket(id, bytes);
+    PacketHandler->put_fields(p, "i", (u4) num_methods);
 
-    PacketHandler->write_fieldid(p, f->fid);
-    PacketHandler->write_str(p, f->fieldName); // assume all methods are non-compile generated?
-    PacketHandler->write_utf(p, f->fieldJNIsignature);
-    PacketHandler->write_u4(p, 0); // empty jni generic string signature
-    PacketHandler->write_u4(p, f->modBits);
+    // assume all methods are non-compile generated?
+    for(start = 0; start < num_methods; start++) {
+        if(generic) {
+            PacketHandler->put_fields(p, METHOD_GENERIC_FIELDS, m[start]->mid, m[start]->methodName, m[start]->methodJNISignature, 0, m[start]->modBits);
+        }
+        else {
+            PacketHandler->put_fields(p, METHOD_FIELDS, m[start]->mid, m[start]->methodName, m[start]->methodJNISignature, m[start]->modBits);
+        }
+    }
 
     return p;
 }
 
-inline static Packet* field_bytes(field* f) {
-    size_t psize = fieldID__SIZE + int__SIZE;
-    psize += string__SIZE(f->fieldName);
-    psize += PacketHandler->utf_size(f->fieldJNIsignature);
-
-    Packet* p = PacketHandler->newRawPacket(psize);
-
-    PacketHandler->write_fieldid(p, f->fid);
-    PacketHandler->write_str(p, f->fieldName); // assume all methods are non-compile generated?
-    PacketHandler->write_utf(p, f->fieldJNIsignature);
-    PacketHandler->write_u4(p, f->modBits);
-
-    return p;
+inline static Packet* methodsWithGeneric_to_Reply(u4 id, RefTypeID* typeID) {
+    return methodList_to_Reply(id, typeID, TRUE);
 }
 
-inline static PacketList* fields_to_PacketList(RefTypeID* typeID) {
-    u2 num_fields = typeID->num_fields; // 2 bytes method count is enough i guess!
+inline static Packet* methods_to_Reply(u4 id, RefTypeID* typeID) {
+    return methodList_to_Reply(id, typeID, FALSE);
+}
 
+inline static Packet* fieldList_to_Reply(u4 id, RefTypeID* typeID, u1 generic) {
+    u2 num_fields = typeID->num_fields;
     field** f = typeID->fields;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
+    size_t bytes = int__SIZE;
+    u2 start;
 
-    u2 start = 0;
-    while(start < num_fields) {
-        PacketHandler->add_Packet(field_bytes(f[start]), pList);
-        start++;
+    for(start = 0; start < num_fields; start++) {
+        bytes += PacketHandler->sizeof_fields(FIELD_FIELDS, f[start]->fid, f[start]->fieldName, f[start]->fieldJNIsignature, f[start]->modBits);
+    }
+    if(generic) {
+        bytes += num_fields * int__SIZE;
     }
 
-    return pList;
-}
-
-inline static Packet* method_bytes(method* m) {
-    size_t psize = methodID__SIZE + int__SIZE;
-    psize += string__SIZE(m->methodName);
-    psize += PacketHandler->utf_size(m->methodJNISignature);
+    Packet* p = PacketHandler->newReplyPacket(id, bytes);
+    PacketHandler->put_fields(p, "i", (u4) num_fields);
 
-    Packet* p = PacketHandler->newRawPacket(psize);
-    PacketHandler->write_methodid(p, m->mid);
-    PacketHandler->write_str(p, m->methodName); // assume all methods are non-compile generated?
-    PacketHandler->write_utf(p, m->methodJNISignature);
-    PacketHandler->write_u4(p, m->modBits);
+    for(start = 0; start < num_fields; start++) {
+        if(generic) {
+            PacketHandler->put_fields(p, FIELD_GENERIC_FIELDS, f[start]->fid, f[start]->fieldName, f[start]->fieldJNIsignature, 0, f[start]->modBits);
+        }
+        else {
+            PacketHandler->put_fields(p, FIELD_FIELDS, f[start]->fid, f[start]->fieldName, f[start]->fieldJNIsignature, f[start]->modBits);
+        }
+    }
 
     return p;
 }
 
-inline static PacketList* methods_to_PacketList(RefTypeID* typeID) {
-    u2 num_methods = typeID->num_methods; // 2 bytes method count is enough i guess!
-
-    method** m = typeID->methods;
-    PacketList* pList = (PacketList*) malloc(sizeof(PacketList));
-    pList->size = 0;
-
-    u2 start = 0;
-    while(start < num_methods) {
-        PacketHandler->add_Packet(method_bytes(m[start]), pList);
-        start++;
-    }
+inline static Packet* fieldsWithGeneric_to_Reply(u4 id, RefTypeID* typeID) {
+    return fieldList_to_Reply(id, typeID, TRUE);
+}
 
-    return pList;
+inline static Packet* fields_to_Reply(u4 id, RefTypeID* typeID) {
+    return fieldList_to_Reply(id, typeID, FALSE);
 }
 
 inline static u2* mk_array_sign(u1* clazzname) {
@@ -365,7 +356,7 @@ inline static u2* mk_class_sign(u1* clazzname) {
     clazzsignature[0] = (u2) 'L';
 
     size_t start = 1;
-    while(start < len - 2) {
+    while(start < len - 1) {
         clazzsignature[start] = (u2) clazzname[start - 1];
         start++;
     }
@@ -388,14 +379,136 @@ inline static u2* mku2(u1* str) {
     return u2str;
 }
 
+// FNV-1a over the name, and over the u2 chars of a signature
+inline static size_t hash_name(u1* name) {
+    size_t h = 2166136261u;
+    while(*name) {
+        h = (h ^ *name++) * 16777619u;
+    }
+    return h;
+}
+
+inline static size_t hash_sign(u2* sign) {
+    size_t h = 2166136261u;
+    while(*sign) {
+        h = (h ^ *sign++) * 16777619u;
+    }
+    return h;
+}
+
+inline static u1 same_sign(u2* a, u2* b) {
+    while(*a != 0 && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+inline static void index_init(RefIndex* idx) {
+    idx->slots = (RefSlot*) calloc(REF_INDEX_INITIAL, sizeof(RefSlot));
+    idx->mask  = REF_INDEX_INITIAL - 1;
+    idx->size  = 0;
+
+    if(idx->slots == NULL) {
+        MHandler->error_exit("failed allocating reference type index!");
+    }
+}
+
+inline static void index_grow(RefIndex* idx) {
+    RefSlot* old    = idx->slots;
+    size_t oldcap   = idx->mask + 1;
+    size_t i;
+    size_t j;
+
+    idx->slots = (RefSlot*) calloc(oldcap << 1, sizeof(RefSlot));
+    if(idx->slots == NULL) {
+        MHandler->error_exit("failed allocating reference type index!");
+    }
+    idx->mask = (oldcap << 1) - 1;
+
+    for(i = 0; i < oldcap; i++) {
+        if(old[i].ref != NULL) {
+            j = old[i].hash & idx->mask;
+            while(idx->slots[j].ref != NULL) {
+                j = (j + 1) & idx->mask;
+            }
+            idx->slots[j] = old[i];
+        }
+    }
+
+    free(old);
+}
+
+// returns the slot holding key, or the empty slot it would go to
+inline static RefSlot* index_slot(RefIndex* idx, size_t hash, u1* name, u2* sign) {
+    size_t i = hash & idx->mask;
+    RefSlot* slot;
+
+    while((slot = idx->slots + i)->ref != NULL) {
+        if(slot->hash == hash) {
+            if(name != NULL ? strcmp(slot->ref->clazzname, name) == 0
+                            : same_sign(slot->ref->signature, sign)) {
+                return slot;
+            }
+        }
+        i = (i + 1) & idx->mask;
+    }
+
+    return slot;
+}
+
+inline static void index_put(RefIndex* idx, size_t hash, u1* name, u2* sign, RefTypeID* typeID) {
+    if((idx->size + 1) << 1 > idx->mask + 1) {
+        index_grow(idx);
+    }
+
+    RefSlot* slot = index_slot(idx, hash, name, sign);
+    if(slot->ref == NULL) {
+        idx->size++;
+    }
+    slot->hash = hash;
+    slot->ref  = typeID;
+}
+
+inline static void index_ref(RefTypeID* typeID) {
+    referencetypeid_t rid = typeID->ref_clazzid;
+
+    if(rid >= refsByRidCap) {
+        size_t newcap = refsByRidCap == 0 ? REF_INDEX_INITIAL : refsByRidCap;
+        while(newcap <= rid) {
+            newcap <<= 1;
+        }
+
+        refsByRid = (RefTypeID**) realloc(refsByRid, newcap * sizeof(RefTypeID*));
+        if(refsByRid == NULL) {
+            MHandler->error_exit("failed allocating reference type index!");
+        }
+        memset(refsByRid + refsByRidCap, 0, (newcap - refsByRidCap) * sizeof(RefTypeID*));
+        refsByRidCap = newcap;
+    }
+    refsByRid[rid] = typeID;
+
+    if(typeID->clazzname != NULL) {
+        index_put(&refsByName, hash_name(typeID->clazzname), typeID->clazzname, NULL, typeID);
+    }
+    if(typeID->signature != NULL) {
+        index_put(&refsBySign, hash_sign(typeID->signature), NULL, typeID->signature, typeID);
+    }
+}
+
 inline static void add_RefTypeID(RefTypeID* typeID) {
     typeID->ref_clazzid     = _OID++;
+    if(typeID->signature == NULL && typeID->clazzname != NULL) {
+        typeID->signature   = mk_class_sign(typeID->clazzname);
+    }
+
     refTypeIDBuff* objbuff  = (refTypeIDBuff*) malloc(sizeof(refTypeIDBuff));
     objbuff->reftypeid      = typeID;
     objbuff->next           = refList->head;
     refList->head           = objbuff;
 
     refList->size++;
+    index_ref(typeID);
 }
 
 inline static RefTypeID* add_ref(u1* clazzname, RefTypeID* superClass) {
@@ -421,6 +534,7 @@ inline static RefTypeID* add_ref(u1* clazzname, RefTypeID* superClass) {
     refList->head = objbuff;
 
     refList->size++;
+    index_ref(objbuff->reftypeid);
     return objbuff->reftypeid;
 }
 
@@ -472,31 +586,7 @@ inline static RefTypeID* findref_Bysign(u2* sign) {
         return NULL;
     }
 
-    refTypeIDBuff* cur = refList->head;
-    size_t lsize = refList->size;
-    size_t start = 0;
-    u2 tchar;
-    u2 schar;
-    while(lsize-- > 0) {
-        do {
-            tchar = *(cur->reftypeid->signature + start);
-            schar = *(sign + start);
-
-            if(tchar != schar) {
-                break;
-            }
-
-            start++;
-        } while(tchar != NULL && schar != NULL);
-
-        if(tchar == tchar) {
-            return cur->reftypeid;
-        }
-
-        cur = cur->next;
-    }
-
-    return NULL;
+    return index_slot(&refsBySign, hash_sign(sign), NULL, sign)->ref;
 }
 
 inline static RefTypeID* findref_Byclassname(u1* clazznamep) {
@@ -504,48 +594,32 @@ inline static RefTypeID* findref_Byclassname(u1* clazznamep) {
         return NULL;
     }
 
-    refTypeIDBuff* cur = refList->head;
-    size_t lsize = refList->size;
-
-    while(lsize-- > 0) {
-        if(strcmp(cur->reftypeid->clazzname, clazznamep) == 0) {
-            return cur->reftypeid;
-        }
-
-        cur = cur->next;
-    }
-
-    return NULL;
+    return index_slot(&refsByName, hash_name(clazznamep), clazznamep, NULL)->ref;
 }
 
 inline static RefTypeID* findref_Byrid(referencetypeid_t rid) {
-    refTypeIDBuff* cur = refList->head;
-    size_t lsize = refList->size;
-
-    while(lsize-- > 0) {
-        if(cur->reftypeid->ref_clazzid == rid) {
-            return cur->reftypeid;
-        }
-
-        cur = cur->next;
-    }
-
-    return NULL;
+    return rid < refsByRidCap ? refsByRid[rid] : NULL;
 }
 
 void init_refTypeHandler() {
     _OID = 1;
     refList = (refTypeID_list*) malloc(sizeof(refTypeID_list));
     refList->size                                       = 0;
+    refList->head                                       = NULL;
+
+    index_init(&refsByName);
+    index_init(&refsBySign);
+    refsByRid                                           = NULL;
+    refsByRidCap                                        = 0;
 
     RefHandler->find_ByID                               = findref_Byrid;
     RefHandler->find_BySignature                        = findref_Bysign;
-    RefHandler->methods_to_PacketList                   = methods_to_PacketList;
-    RefHandler->fields_to_PacketList                    = fields_to_PacketList;
-    RefHandler->fields_WithGeneric_to_PacketList        = fieldsWithGeneric_to_PacketList;
-    RefHandler->methods_WithGeneric_to_PacketList       = methodsWithGeneric_to_PacketList;
-    RefHandler->allClazzRefs_to_PacketList              = allClassesRefs_to_PacketList;
-    RefHandler->allClazzRefsWithGenetrics_to_PacketList = allClassesRefsWithGenerics_to_PacketList;
+    RefHandler->methods_to_Reply                        = methods_to_Reply;
+    RefHandler->fields_to_Reply                         = fields_to_Reply;
+    RefHandler->fields_WithGeneric_to_Reply             = fieldsWithGeneric_to_Reply;
+    RefHandler->methods_WithGeneric_to_Reply            = methodsWithGeneric_to_Reply;
+    RefHandler->allClazzRefs_to_Reply                   = allClassesRefs_to_Reply;
+    RefHandler->allClazzRefsWithGenetrics_to_Reply      = allClassesRefsWithGenerics_to_Reply;
     RefHandler->allClassesCount                         = allClassesRefsCount;
     RefHandler->get_method                              = get_method;
     RefHandler->add_startedOf                           = add_Inner_Classes_Stared_Of;
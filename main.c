@@ -26,6 +26,23 @@
 int64_t sys_Sys_ticks(SedonaVM* vm, Cell* params);
 void sys_Sys_sleep(SedonaVM* vm, Cell* params);
 
+// sys::StdOutStream forward
+void sys_StdOutStream_setFlushInterval(int ms);
+void sys_StdOutStream_sync();
+
+// sys::FileStore forward
+void sys_FileStore_setDurability(int mode);
+
+// native kit plugins, see natives/nativeplugin.h
+int loadNativePlugins(const char* dir);
+int installNativePlugins(SedonaVM* vm);
+static const char* pluginDir = "plugins";
+
+// jdwp forward, see jdwp/mainHandler.h
+#ifdef VM_DEBUG_MODE
+void jdwp_setWaitForIde(int wait);
+#endif
+
 int64_t yieldNs = 0;
 
 // forwards
@@ -69,6 +86,31 @@ int main(int argc, char *argv[])
         if (chdir(home) != 0) return printUsage(argv[0]);
         optCount++;
       }
+      else if (strncmp(arg, "--flush=", 8) == 0)
+      {
+        if (strlen(arg) < 9) return printUsage(argv[0]);
+        sys_StdOutStream_setFlushInterval(atoi(arg+8));
+        optCount++;
+      }
+      else if (strncmp(arg, "--fsync=", 8) == 0)
+      {
+        if (strlen(arg) < 9) return printUsage(argv[0]);
+        sys_FileStore_setDurability(atoi(arg+8));
+        optCount++;
+      }
+#ifdef VM_DEBUG_MODE
+      else if (strcmp(arg, "--jdwp-wait") == 0)
+      {
+        jdwp_setWaitForIde(TRUE);
+        optCount++;
+      }
+#endif
+      else if (strncmp(arg, "--plugins=", 10) == 0)
+      {
+        if (strlen(arg) < 11) return printUsage(argv[0]);
+        pluginDir = arg+10;
+        optCount++;
+      }
     }
     else
     {
@@ -136,6 +178,7 @@ static int runInPlatformMode()
       result = vmResume(&vm);
     }
 
+    sys_StdOutStream_sync();
     if (result != 0)
     {
       if (result == ERR_RESTART)
@@ -195,6 +238,7 @@ static int runInStandaloneMode(const char* filename, int vmArgc, char* vmArgv[])
 
 
   // done
+  sys_StdOutStream_sync();
   if (result != 0)
   {
     printf("Cannot run VM (%d)\n", result);
@@ -272,15 +316,14 @@ static int commonVmSetup(SedonaVM* vm, const char* scodeFile)
   // setup callbacks
   vm->onAssertFailure = onAssertFailure;
 
-  // setup native method table
+  // setup native method table, adding any plugin kits the image uses
+  loadNativePlugins(pluginDir);
+  installNativePlugins(vm);
   vm->nativeTable = nativeTable;
 
-  // setup call function pointer
-  #ifdef VM_DEBUG_MODE
-    vm->call = vmCallDebug;
-  #else
-    vm->call = vmCall;
-  #endif
+  // setup call function pointer; in VM_DEBUG_MODE vmCall hands
+  // calls over to vmCallDebug while a debugger has requests
+  vm->call = vmCall;
 
   return 0;
 }
@@ -298,6 +341,12 @@ static int printUsage(const char* exe)
   printf("  --?       dump usage\n");
   printf("  --ver     dump version\n");
   printf("  --home=d  set current working directory\n");
+  printf("  --flush=ms stdout flush interval, 0 writes through\n");
+  printf("  --fsync=n  fsync written files: 0 never, 1 on close, 2 on flush (default)\n");
+  printf("  --plugins=d load native kit plugins (*.so) from d, default 'plugins'\n");
+#ifdef VM_DEBUG_MODE
+  printf("  --jdwp-wait halt until the debugger attached, default attaches later\n");
+#endif
   printf("  --plat    run in platform mode. 'kits.scode[.stage]' and 'app.sab[.stage]'\n");
   printf("            must be present in the working directory\n");
   return 0;
@@ -404,6 +453,7 @@ static void checkStaged(const char* filename)
 
 static void onAssertFailure(const char* location, uint16_t linenum)
 {
+  sys_StdOutStream_sync();
   printf("ASSERT FAILURE: %s [Line %d]\n", location, linenum);
 }
 
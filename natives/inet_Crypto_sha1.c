@@ -10,8 +10,8 @@
 #include "inet_sha1.h"
 
 //
-// This implementation of Crypt.sha1 uses the code straight
-// from RFC 3174:
+// This implementation of Crypt.sha1 uses the code from
+// RFC 3174 (with an unrolled/SHA-NI block function):
 //
 //    http://tools.ietf.org/html/rfc3174
 //
@@ -36,8 +36,55 @@ Cell inet_Crypto_sha1(SedonaVM* vm, Cell* params)
   return nullCell;
 }
 
+//
+// Incremental variant for hashing streamed data (sox auth,
+// file checksums) without first copying it into one buffer.
+// The context is opaque to Sedona code; sha1Final releases it.
+//
+// static Obj sha1Init()
+//
+Cell inet_Crypto_sha1Init(SedonaVM* vm, Cell* params)
+{
+  Cell result;
+  SHA1Context* cx = (SHA1Context*)malloc(sizeof(SHA1Context));
+
+  if (cx == NULL) return nullCell;
+  SHA1Reset(cx);
+
+  result.aval = cx;
+  return result;
+}
+
+//
+// static void sha1Update(Obj cx, byte[] input, int inputOff, int len)
+//
+Cell inet_Crypto_sha1Update(SedonaVM* vm, Cell* params)
+{
+  SHA1Context* cx = (SHA1Context*)params[0].aval;
+  uint8_t* in     = params[1].aval;
+  int32_t  inOff  = params[2].ival;
+  int32_t  len    = params[3].ival;
+
+  if (cx == NULL || len <= 0) return nullCell;
+
+  SHA1Input(cx, in + inOff, len);
 
+  return nullCell;
+}
 
+//
+// static void sha1Final(Obj cx, byte[] output, int outputOff)
+//
+Cell inet_Crypto_sha1Final(SedonaVM* vm, Cell* params)
+{
+  SHA1Context* cx = (SHA1Context*)params[0].aval;
+  uint8_t* out    = params[1].aval;
+  int32_t  outOff = params[2].ival;
 
+  if (cx == NULL) return nullCell;
 
+  SHA1Result(cx, out + outOff);
+  free(cx);
 
+  return nullCell;
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Creation
+//
+
+#include "inet_util_std.h"
+
+#ifdef __linux__
+ #include <sys/epoll.h>
+ #include <unistd.h>
+ #define REACTOR_EPOLL
+#endif
+
+//
+// Readiness reactor for TcpSocket, TcpServerSocket and UdpSocket.
+// Sockets are registered once with an app chosen int token; one
+// poll() per scan then returns the tokens that are ready instead
+// of every socket being probed every cycle.  Interest and result
+// masks use INET_READ, INET_WRITE and INET_ERROR.  A connecting
+// TcpSocket reports INET_WRITE once finishConnect() will complete.
+//
+// The reactor is level triggered, so a socket stays ready until
+// it has been read or written down to would-block.  Closing a
+// socket removes it from the reactor.
+//
+// On platforms without epoll open() returns -1 and apps keep
+// polling each socket as before.
+//
+
+#ifndef REACTOR_MAX_EVENTS
+#define REACTOR_MAX_EVENTS 256
+#endif
+
+#ifdef REACTOR_EPOLL
+static uint32_t toEpoll(int32_t interest)
+{
+  uint32_t ev = 0;
+  if (interest & INET_READ)  ev |= EPOLLIN;
+  if (interest & INET_WRITE) ev |= EPOLLOUT;
+  return ev;
+}
+
+static int32_t fromEpoll(uint32_t ev)
+{
+  int32_t r = 0;
+  if (ev & (EPOLLIN | EPOLLRDHUP)) r |= INET_READ;
+  if (ev & EPOLLOUT)               r |= INET_WRITE;
+  if (ev & (EPOLLERR | EPOLLHUP))  r |= INET_ERROR;
+  return r;
+}
+#endif
+
+//
+// Create a reactor, returns its handle or -1 if unsupported.
+//
+// static int open()
+//
+Cell inet_Reactor_open(SedonaVM* vm, Cell* params)
+{
+#ifdef REACTOR_EPOLL
+  Cell result;
+  result.ival = epoll_create1(EPOLL_CLOEXEC);
+  return result.ival < 0 ? negOneCell : result;
+#else
+  return negOneCell;
+#endif
+}
+
+//
+// Register socket with the given interest mask and token, or
+// update the registration if it is already watched.
+//
+// static bool watch(int reactor, Obj socket, int interest, int token)
+//
+Cell inet_Reactor_watch(SedonaVM* vm, Cell* params)
+{
+#ifdef REACTOR_EPOLL
+  int32_t reactor  = params[0].ival;
+  void*   self     = params[1].aval;
+  int32_t interest = params[2].ival;
+  int32_t token    = params[3].ival;
+  struct epoll_event ev;
+  socket_t sock;
+
+  if (reactor < 0 || self == NULL || getClosed(self)) return falseCell;
+  sock = getSocket(self);
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events   = toEpoll(interest) | EPOLLRDHUP;
+  ev.data.u64 = (uint32_t)token;
+
+  if (epoll_ctl(reactor, EPOLL_CTL_ADD, sock, &ev) == 0) return trueCell;
+  if (errno == EEXIST && epoll_ctl(reactor, EPOLL_CTL_MOD, sock, &ev) == 0) return trueCell;
+#endif
+  return falseCell;
+}
+
+//
+// Stop watching socket.
+//
+// static bool unwatch(int reactor, Obj socket)
+//
+Cell inet_Reactor_unwatch(SedonaVM* vm, Cell* params)
+{
+#ifdef REACTOR_EPOLL
+  int32_t reactor = params[0].ival;
+  void*   self    = params[1].aval;
+  struct epoll_event ev;   // non-null for pre 2.6.9 kernels
+
+  if (reactor < 0 || self == NULL || getClosed(self)) return falseCell;
+
+  if (epoll_ctl(reactor, EPOLL_CTL_DEL, getSocket(self), &ev) == 0) return trueCell;
+#endif
+  return falseCell;
+}
+
+//
+// Fill tokens/events with up to max ready sockets and return how
+// many there are.  Use timeout 0 during the scan; when the VM is
+// idle pass the ms left until the next deadline to block in the
+// kernel instead of spinning.  Returns -1 on error.
+//
+// static int poll(int reactor, int[] tokens, int[] events, int max, int timeout)
+//
+Cell inet_Reactor_poll(SedonaVM* vm, Cell* params)
+{
+#ifdef REACTOR_EPOLL
+  int32_t  reactor = params[0].ival;
+  int32_t* tokens  = (int32_t*)params[1].aval;
+  int32_t* events  = (int32_t*)params[2].aval;
+  int32_t  max     = params[3].ival;
+  int32_t  timeout = params[4].ival;
+  struct epoll_event ready[REACTOR_MAX_EVENTS];
+  Cell result;
+  int i, n;
+
+  if (reactor < 0 || tokens == NULL || events == NULL || max <= 0) return negOneCell;
+  if (max > REACTOR_MAX_EVENTS) max = REACTOR_MAX_EVENTS;
+  if (timeout < 0) timeout = 0;
+
+  n = epoll_wait(reactor, ready, max, timeout);
+  if (n < 0)
+  {
+    if (errno != EINTR) return negOneCell;
+    n = 0;
+  }
+
+  for (i=0; i<n; ++i)
+  {
+    tokens[i] = (int32_t)ready[i].data.u64;
+    events[i] = fromEpoll(ready[i].events);
+  }
+
+  result.ival = n;
+  return result;
+#else
+  return negOneCell;
+#endif
+}
+
+//
+// Free the reactor, watched sockets stay open.
+//
+// static void close(int reactor)
+//
+Cell inet_Reactor_close(SedonaVM* vm, Cell* params)
+{
+#ifdef REACTOR_EPOLL
+  int32_t reactor = params[0].ival;
+  if (reactor >= 0) close(reactor);
+#endif
+  return nullCell;
+}
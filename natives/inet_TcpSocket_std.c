@@ -5,9 +5,25 @@
 // History:
 //   22 Aug 06  Brian Frank  Creation
 //   07 May 07  Brian Frank  Port from C++ old Sedona
+//   19 Oct 26  sendFile
 //
 
 #include "inet_util_std.h"
+#include "sys_FileStore_std.h"
+
+#ifdef __linux__
+ #include <sys/sendfile.h>
+ #define TCP_USE_SENDFILE
+#endif
+
+#ifndef _WIN32
+ #include <unistd.h>     // for pread
+#endif
+
+// chunk size when the platform has no sendfile
+#ifndef TCP_SENDFILE_CHUNK
+#define TCP_SENDFILE_CHUNK 4096
+#endif
 
 //
 // Connect this socket to the specified IP address and port.
@@ -180,6 +196,112 @@ Cell inet_TcpSocket_write(SedonaVM* vm, Cell* params)
   return negOneCell;
 }
 
+//
+// Send len bytes of an open FileStore file starting at file
+// offset off, without the bytes passing through VM memory.
+// Like write() this may send less than len on a non-blocking
+// socket: the return is the number of bytes sent this call (0
+// if the socket would block), so the caller advances off by it
+// and calls again until done.  The file position is not moved.
+// If the connection fails the socket is closed and -1 is
+// returned; -1 is also returned, leaving the socket open, if the
+// file can't be read (closed, or opened for write-behind).  A
+// read handle whose mapping was dropped by a write open of the
+// same file is read by offset from its fd.
+//
+// int sendFile(Obj file, int off, int len)
+//
+Cell inet_TcpSocket_sendFile(SedonaVM* vm, Cell* params)
+{
+  void*       self = params[0].aval;
+  FileHandle* h    = (FileHandle*)params[1].aval;
+  int32_t     off  = params[2].ival;
+  int32_t     len  = params[3].ival;
+  socket_t    sock = getSocket(self);
+  int32_t     sent = 0;
+  int         n    = 0;
+  Cell result;
+
+  if (getClosed(self) || h == NULL || isWriteBehind(h) || off < 0) return negOneCell;
+  if (len <= 0) return zeroCell;
+
+  if (isMapped(h))
+  {
+    // already in memory, send straight from the mapping
+    if ((size_t)off >= h->size) return zeroCell;
+    if ((size_t)(off + len) > h->size) len = (int32_t)(h->size - off);
+    while (sent < len)
+    {
+      n = send(sock, h->map + off + sent, len - sent, 0);
+      if (n <= 0) break;
+      sent += n;
+    }
+  }
+  else
+  {
+#ifdef TCP_USE_SENDFILE
+    off_t pos = off;
+    int fd = isPread(h) ? h->fd : fileno(h->fp);
+
+    // 'm' mode handles may have buffered writes we must see
+    if (!isPread(h)) fflush(h->fp);
+    while (sent < len)
+    {
+      n = (int)sendfile(sock, fd, &pos, len - sent);
+      if (n <= 0) break;   // 0 is end of file
+      sent += n;
+    }
+#else
+    uint8_t chunk[TCP_SENDFILE_CHUNK];
+    int r;
+
+    if (isPread(h))
+    {
+ #ifndef _WIN32
+      while (sent < len)
+      {
+        r = (int)pread(h->fd, chunk, len - sent < TCP_SENDFILE_CHUNK ? len - sent : TCP_SENDFILE_CHUNK, (off_t)off + sent);
+        if (r <= 0) { n = 0; break; }
+        n = send(sock, chunk, r, 0);
+        if (n <= 0) break;
+        sent += n;
+        if (n < r) break;    // socket is full, resume at off+sent next call
+      }
+ #else
+      return negOneCell;
+ #endif
+    }
+    else
+    {
+      long saved = ftell(h->fp);
+
+      fflush(h->fp);
+      if (fseek(h->fp, off, SEEK_SET) != 0) return negOneCell;
+      while (sent < len)
+      {
+        r = (int)fread(chunk, 1, len - sent < TCP_SENDFILE_CHUNK ? len - sent : TCP_SENDFILE_CHUNK, h->fp);
+        if (r <= 0) { n = 0; break; }
+        n = send(sock, chunk, r, 0);
+        if (n <= 0) break;
+        sent += n;
+        if (n < r) break;    // socket is full, resume at off+sent next call
+      }
+      fseek(h->fp, saved, SEEK_SET);
+    }
+#endif
+  }
+
+  // stopped early: full socket is fine, anything else kills it
+  if (sent == 0 && n < 0 && !inet_errorIsWouldBlock())
+  {
+    inet_TcpSocket_close(vm, params);
+    return negOneCell;
+  }
+
+  result.ival = sent;
+  return result;
+}
+
 //
 // Receive the specified bytes from the socket.  Return the
 // number of bytes actually read which may be equal to
@@ -7,8 +7,14 @@
 //   07 May 07  Brian Frank  Port from C++ old Sedona
 //   09 Jul 12  Elizabeth McKenney/Clif Turman IPV6 support
 //   09 Aug 12  Clif Turman  Add QNX Specific variant
+//   19 Oct 26  Batch send/receive natives
 //
 
+// recvmmsg/sendmmsg, must come before any system header
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+ #define _GNU_SOURCE
+#endif
+
 #include "inet_util_std.h"
 
 //
@@ -409,4 +415,269 @@ Cell inet_UdpSocket_close(SedonaVM* vm, Cell* params)
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+// Batch
+//////////////////////////////////////////////////////////////////////////
+
+//
+// The batch natives move up to UDP_BATCH_MAX datagrams per call.
+// On Linux each call is a single sendmmsg/recvmmsg; elsewhere they
+// loop sendto/recvfrom so apps can use them unconditionally.
+//
+
+#if defined(__linux__)
+ #define UDP_USE_MMSG
+#endif
+
+#ifndef UDP_BATCH_MAX
+#define UDP_BATCH_MAX 64
+#endif
+
+#if defined( SOCKET_FAMILY_INET )
+ #define UDP_ADDR_LEN sizeof(struct sockaddr_in)
+#elif defined( SOCKET_FAMILY_INET6 )
+ #define UDP_ADDR_LEN sizeof(struct sockaddr_in6)
+#endif
+
+//
+// Receive count datagrams into bufs[i]/lens[i], source into
+// addrs[i].  Returns how many arrived, 0 if none pending, -1 on
+// error.
+//
+static int udpRecvBatch(socket_t sock, uint8_t** bufs, int32_t* lens,
+                        struct sockaddr_storage* addrs, int count)
+{
+#ifdef UDP_USE_MMSG
+  struct mmsghdr msgs[UDP_BATCH_MAX];
+  struct iovec   iovs[UDP_BATCH_MAX];
+  int i, n;
+
+  memset(msgs, 0, sizeof(struct mmsghdr) * count);
+  for (i=0; i<count; ++i)
+  {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len  = lens[i];
+    msgs[i].msg_hdr.msg_iov     = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+
+  n = recvmmsg(sock, msgs, count, MSG_DONTWAIT, NULL);
+  if (n < 0) return inet_errorIsWouldBlock() ? 0 : -1;
+
+  for (i=0; i<n; ++i)
+  {
+    // truncated datagrams are errors, same as receive()
+    lens[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? -1 : (int32_t)msgs[i].msg_len;
+  }
+  return n;
+#else
+  int i, r;
+
+  for (i=0; i<count; ++i)
+  {
+    int addrLen = sizeof(struct sockaddr_storage);
+    r = recvfrom(sock, bufs[i], lens[i], 0, (struct sockaddr *)&addrs[i], &addrLen);
+    if (r == SOCKET_ERROR)
+    {
+      if (i > 0 || inet_errorIsWouldBlock()) return i;
+      return -1;
+    }
+    lens[i] = r;
+  }
+  return count;
+#endif
+}
+
+//
+// Send count datagrams, returns how many went out or -1 if the
+// first one failed.
+//
+static int udpSendBatch(socket_t sock, uint8_t** bufs, int32_t* lens,
+                        struct sockaddr_storage* addrs, int count)
+{
+#ifdef UDP_USE_MMSG
+  struct mmsghdr msgs[UDP_BATCH_MAX];
+  struct iovec   iovs[UDP_BATCH_MAX];
+  int i, n;
+
+  memset(msgs, 0, sizeof(struct mmsghdr) * count);
+  for (i=0; i<count; ++i)
+  {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len  = lens[i];
+    msgs[i].msg_hdr.msg_iov     = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = UDP_ADDR_LEN;
+  }
 
+  n = sendmmsg(sock, msgs, count, MSG_DONTWAIT);
+  if (n < 0) return inet_errorIsWouldBlock() ? 0 : -1;
+  return n;
+#else
+  int i;
+
+  for (i=0; i<count; ++i)
+  {
+    if (sendto(sock, bufs[i], lens[i], 0, (const struct sockaddr *)&addrs[i], UDP_ADDR_LEN) == SOCKET_ERROR)
+      return (i > 0 || inet_errorIsWouldBlock()) ? i : -1;
+  }
+  return count;
+#endif
+}
+
+//
+// Send the first count datagrams of the array with one system
+// call.  Returns the number sent (which may be short if the
+// socket buffer fills) or -1 on failure.
+//
+// int sendBatch(UdpDatagram[] datagrams, int count)
+//
+Cell inet_UdpSocket_sendBatch(SedonaVM* vm, Cell* params)
+{
+  void*  self       = params[0].aval;
+  void** sDatagrams = (void**)params[1].aval;
+  int32_t count     = params[2].ival;
+  socket_t sock     = getSocket(self);
+  bool closed       = getClosed(self);
+
+  struct UdpDatagram datagram;
+  uint8_t* bufs[UDP_BATCH_MAX];
+  int32_t  lens[UDP_BATCH_MAX];
+  struct sockaddr_storage addrs[UDP_BATCH_MAX];
+  Cell result;
+  int i;
+
+  if (closed || sDatagrams == NULL) return negOneCell;
+  if (count <= 0) return zeroCell;
+  if (count > UDP_BATCH_MAX) count = UDP_BATCH_MAX;
+
+  memset(addrs, 0, sizeof(struct sockaddr_storage) * count);
+  for (i=0; i<count; ++i)
+  {
+    if (sDatagrams[i] == NULL) return negOneCell;
+    getUdpDatagram(sDatagrams[i], &datagram);
+    if (datagram.buf == NULL || datagram.addr == NULL) return negOneCell;
+
+    inet_toSockaddr(&addrs[i], datagram.addr, datagram.port, datagram.scope, datagram.flow);
+    bufs[i] = datagram.buf + datagram.off;
+    lens[i] = datagram.len;
+  }
+
+  result.ival = udpSendBatch(sock, bufs, lens, addrs, count);
+  if (result.ival < 0) printf("  sendmmsg error: %s\n", ERRNO_MSG());
+  return result;
+}
+
+//
+// Receive up to count datagrams with one system call.  Each
+// datagram is filled in like receive(); since the socket's inline
+// address can only hold one source, addrs[i] is used as the
+// storage for datagrams[i].addr.  Returns the number received,
+// 0 if nothing is pending, or -1 on failure.  A datagram that was
+// truncated is returned with len=-1.
+//
+// int receiveBatch(UdpDatagram[] datagrams, IpAddr[] addrs, int count)
+//
+Cell inet_UdpSocket_receiveBatch(SedonaVM* vm, Cell* params)
+{
+  void*  self       = params[0].aval;
+  void** sDatagrams = (void**)params[1].aval;
+  void** ipAddrs    = (void**)params[2].aval;
+  int32_t count     = params[3].ival;
+  socket_t sock     = getSocket(self);
+  bool closed       = getClosed(self);
+
+  struct UdpDatagram datagram;
+  uint8_t* bufs[UDP_BATCH_MAX];
+  int32_t  lens[UDP_BATCH_MAX];
+  struct sockaddr_storage addrs[UDP_BATCH_MAX];
+  Cell result;
+  int i, n;
+
+  if (closed || sDatagrams == NULL || ipAddrs == NULL) return negOneCell;
+  if (count <= 0) return zeroCell;
+  if (count > UDP_BATCH_MAX) count = UDP_BATCH_MAX;
+
+  for (i=0; i<count; ++i)
+  {
+    if (sDatagrams[i] == NULL || ipAddrs[i] == NULL) return negOneCell;
+    getUdpDatagram(sDatagrams[i], &datagram);
+    if (datagram.buf == NULL) return negOneCell;
+    bufs[i] = datagram.buf + datagram.off;
+    lens[i] = datagram.len;
+  }
+
+  n = udpRecvBatch(sock, bufs, lens, addrs, count);
+
+  for (i=0; i<n; ++i)
+  {
+    getUdpDatagram(sDatagrams[i], &datagram);
+    inet_fromSockaddr(&addrs[i], ipAddrs[i], &datagram.port, &datagram.scope, &datagram.flow);
+    datagram.len  = lens[i];
+    datagram.addr = ipAddrs[i];
+    setUdpDatagram(sDatagrams[i], &datagram);
+  }
+
+  result.ival = n;
+  return result;
+}
+
+//
+// Zero-copy receive into a ring of fixed size slots owned by the
+// app: slot k is ring[k*slotSize .. (k+1)*slotSize).  Fills up to
+// count slots starting at head (wrapping at slotCount) straight
+// from the kernel, with no UdpDatagram marshaling.  For each slot
+// filled meta[2k] is the length (-1 if truncated) and meta[2k+1]
+// the source port; the source address goes to addrs[k].  Returns
+// the number of slots filled, the app advances head by that much.
+//
+// int receiveRing(byte[] ring, int slotSize, int slotCount, int head, int count, int[] meta, IpAddr[] addrs)
+//
+Cell inet_UdpSocket_receiveRing(SedonaVM* vm, Cell* params)
+{
+  void*    self      = params[0].aval;
+  uint8_t* ring      = (uint8_t*)params[1].aval;
+  int32_t  slotSize  = params[2].ival;
+  int32_t  slotCount = params[3].ival;
+  int32_t  head      = params[4].ival;
+  int32_t  count     = params[5].ival;
+  int32_t* meta      = (int32_t*)params[6].aval;
+  void**   ipAddrs   = (void**)params[7].aval;
+  socket_t sock      = getSocket(self);
+  bool closed        = getClosed(self);
+
+  uint8_t* bufs[UDP_BATCH_MAX];
+  int32_t  lens[UDP_BATCH_MAX];
+  struct sockaddr_storage addrs[UDP_BATCH_MAX];
+  Cell result;
+  int i, n, slot, scope, flow;
+
+  if (closed || ring == NULL || meta == NULL || ipAddrs == NULL) return negOneCell;
+  if (slotSize <= 0 || slotCount <= 0 || head < 0 || head >= slotCount) return negOneCell;
+  if (count > slotCount) count = slotCount;
+  if (count > UDP_BATCH_MAX) count = UDP_BATCH_MAX;
+  if (count <= 0) return zeroCell;
+
+  for (i=0; i<count; ++i)
+  {
+    slot = (head + i) % slotCount;
+    if (ipAddrs[slot] == NULL) return negOneCell;
+    bufs[i] = ring + slot * slotSize;
+    lens[i] = slotSize;
+  }
+
+  n = udpRecvBatch(sock, bufs, lens, addrs, count);
+
+  for (i=0; i<n; ++i)
+  {
+    slot = (head + i) % slotCount;
+    meta[2*slot] = lens[i];
+    inet_fromSockaddr(&addrs[i], ipAddrs[slot], &meta[2*slot+1], &scope, &flow);
+  }
+
+  result.ival = n;
+  return result;
+}
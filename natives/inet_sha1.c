@@ -20,6 +20,13 @@
  *      support 32 bit unsigned integers, this code is not
  *      appropriate.
  *
+ *  Local Changes:
+ *      The message schedule is kept as a 16 word circular buffer and
+ *      the 80 rounds are fully unrolled.  Whole 64 byte blocks are
+ *      compressed straight out of the caller's buffer; only a partial
+ *      tail is copied into Message_Block.  On x86 with gcc the SHA
+ *      extensions are used when cpuid reports them at runtime.
+ *
  *  Caveats:
  *      SHA-1 is designed to work with messages less than 2^64 bits
  *      long.  Although SHA-1 allows a message digest to be generated
@@ -56,16 +63,80 @@
 
 #include "inet_sha1.h"
 
+#include <string.h>
+
+/*
+ *  SHA_NI is only attempted where we can both emit the instructions
+ *  (gcc/clang target attribute) and ask cpuid about them.  Define
+ *  SHA1_NO_SHANI to force the portable code.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(SHA1_NO_SHANI)
+#define SHA1_USE_SHANI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 /*
  *  Define the SHA1 circular left shift macro
  */
 #define SHA1CircularShift(bits,word) \
                 (((word) << (bits)) | ((word) >> (32-(bits))))
 
+/*
+ *  Big endian load of a message word
+ */
+#define SHA1LoadWord(p) \
+                (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | \
+                 ((uint32_t)(p)[2] << 8)  |  (uint32_t)(p)[3])
+
+/*
+ *  Round functions, W[t] for t >= 16 is computed in place in the
+ *  16 word circular schedule.
+ */
+#define SHA1_F0(b,c,d)  ((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_F1(b,c,d)  ((b) ^ (c) ^ (d))
+#define SHA1_F2(b,c,d)  (((b) & (c)) | ((d) & ((b) | (c))))
+#define SHA1_F3(b,c,d)  ((b) ^ (c) ^ (d))
+
+#define SHA1_W(t) \
+    (W[(t) & 15] = SHA1CircularShift(1, W[((t)+13) & 15] ^ W[((t)+8) & 15] ^ \
+                                        W[((t)+2) & 15]  ^ W[(t) & 15]))
+
+#define SHA1_R(a,b,c,d,e,f,k,w) \
+    e += SHA1CircularShift(5,a) + f(b,c,d) + (k) + (w); \
+    b  = SHA1CircularShift(30,b);
+
+#define SHA1_R0(a,b,c,d,e,t) SHA1_R(a,b,c,d,e,SHA1_F0,0x5A827999,W[t])
+#define SHA1_R1(a,b,c,d,e,t) SHA1_R(a,b,c,d,e,SHA1_F0,0x5A827999,SHA1_W(t))
+#define SHA1_R2(a,b,c,d,e,t) SHA1_R(a,b,c,d,e,SHA1_F1,0x6ED9EBA1,SHA1_W(t))
+#define SHA1_R3(a,b,c,d,e,t) SHA1_R(a,b,c,d,e,SHA1_F2,0x8F1BBCDC,SHA1_W(t))
+#define SHA1_R4(a,b,c,d,e,t) SHA1_R(a,b,c,d,e,SHA1_F3,0xCA62C1D6,SHA1_W(t))
+
+/*
+ *  Five rounds rotate the variable names back into place
+ */
+#define SHA1_R5(R,t) \
+    R(A,B,C,D,E,(t)+0) R(E,A,B,C,D,(t)+1) R(D,E,A,B,C,(t)+2) \
+    R(C,D,E,A,B,(t)+3) R(B,C,D,E,A,(t)+4)
+
+typedef void (*SHA1BlockFunc)(uint32_t *, const uint8_t *, size_t);
+
 /* Local Function Prototyptes */
 void SHA1PadMessage(SHA1Context *);
 void SHA1ProcessMessageBlock(SHA1Context *);
 
+static void SHA1ProcessBlocksGeneric(uint32_t *, const uint8_t *, size_t);
+#ifdef SHA1_USE_SHANI
+static void SHA1ProcessBlocksShaNi(uint32_t *, const uint8_t *, size_t);
+#endif
+static SHA1BlockFunc SHA1SelectBlockFunc(void);
+
+/*
+ *  Resolved on first SHA1Reset; every caller races to store the
+ *  same value so no locking is needed.
+ */
+static SHA1BlockFunc SHA1ProcessBlocks = NULL;
+
 /*
  *  SHA1Reset
  *
@@ -88,6 +159,11 @@ int SHA1Reset(SHA1Context *context)
         return shaNull;
     }
 
+    if (!SHA1ProcessBlocks)
+    {
+        SHA1ProcessBlocks = SHA1SelectBlockFunc();
+    }
+
     context->Length_Low             = 0;
     context->Length_High            = 0;
     context->Message_Block_Index    = 0;
@@ -141,11 +217,8 @@ int SHA1Result( SHA1Context *context,
     if (!context->Computed)
     {
         SHA1PadMessage(context);
-        for(i=0; i<64; ++i)
-        {
-            /* message may be sensitive, clear it out */
-            context->Message_Block[i] = 0;
-        }
+        /* message may be sensitive, clear it out */
+        memset(context->Message_Block, 0, sizeof(context->Message_Block));
         context->Length_Low = 0;    /* and clear length */
         context->Length_High = 0;
         context->Computed = 1;
@@ -165,7 +238,8 @@ int SHA1Result( SHA1Context *context,
  *
  *  Description:
  *      This function accepts an array of octets as the next portion
- *      of the message.
+ *      of the message.  It may be called any number of times between
+ *      SHA1Reset and SHA1Result.
  *
  *  Parameters:
  *      context: [in/out]
@@ -184,6 +258,11 @@ int SHA1Input(    SHA1Context    *context,
                   const uint8_t  *message_array,
                   unsigned       length)
 {
+    uint32_t low;
+    uint32_t high;
+    unsigned fill;
+    size_t   blocks;
+
     if (!length)
     {
         return shaSuccess;
@@ -204,28 +283,58 @@ int SHA1Input(    SHA1Context    *context,
     {
          return context->Corrupted;
     }
-    while(length-- && !context->Corrupted)
+
+    /*
+     *  Account for the whole run up front, Length is in bits
+     */
+    low  = context->Length_Low + ((uint32_t)length << 3);
+    high = context->Length_High + ((uint32_t)length >> 29) +
+           (low < context->Length_Low ? 1 : 0);
+    if (high < context->Length_High)
     {
-    context->Message_Block[context->Message_Block_Index++] =
-                    (*message_array & 0xFF);
+        /* Message is too long */
+        context->Corrupted = 1;
+        return shaInputTooLong;
+    }
+    context->Length_Low  = low;
+    context->Length_High = high;
 
-    context->Length_Low += 8;
-    if (context->Length_Low == 0)
+    /*
+     *  Top up a partially filled block first
+     */
+    if (context->Message_Block_Index)
     {
-        context->Length_High++;
-        if (context->Length_High == 0)
+        fill = 64 - context->Message_Block_Index;
+        if (length < fill)
         {
-            /* Message is too long */
-            context->Corrupted = 1;
+            memcpy(context->Message_Block + context->Message_Block_Index,
+                   message_array, length);
+            context->Message_Block_Index += length;
+            return shaSuccess;
         }
+
+        memcpy(context->Message_Block + context->Message_Block_Index,
+               message_array, fill);
+        SHA1ProcessMessageBlock(context);
+        message_array += fill;
+        length        -= fill;
     }
 
-    if (context->Message_Block_Index == 64)
+    /*
+     *  Whole blocks are compressed in place, no copy
+     */
+    blocks = length >> 6;
+    if (blocks)
     {
-        SHA1ProcessMessageBlock(context);
+        SHA1ProcessBlocks(context->Intermediate_Hash, message_array, blocks);
+        message_array += blocks << 6;
+        length        &= 63;
     }
 
-    message_array++;
+    if (length)
+    {
+        memcpy(context->Message_Block, message_array, length);
+        context->Message_Block_Index = length;
     }
 
     return shaSuccess;
@@ -244,100 +353,300 @@ int SHA1Input(    SHA1Context    *context,
  *  Returns:
  *      Nothing.
  *
+ */
+void SHA1ProcessMessageBlock(SHA1Context *context)
+{
+    SHA1ProcessBlocks(context->Intermediate_Hash, context->Message_Block, 1);
+    context->Message_Block_Index = 0;
+}
+
+/*
+ *  SHA1ProcessBlocksGeneric
+ *
+ *  Description:
+ *      Portable compression of nblocks consecutive 64 byte blocks.
+ *      The schedule lives in a 16 word ring and all 80 rounds are
+ *      unrolled so the working variables stay in registers.
+ *
  *  Comments:
  *      Many of the variable names in this code, especially the
  *      single character names, were used because those were the
  *      names used in the publication.
  *
- *
  */
-void SHA1ProcessMessageBlock(SHA1Context *context)
+static void SHA1ProcessBlocksGeneric(uint32_t *H,
+                                     const uint8_t *data,
+                                     size_t nblocks)
 {
-    const uint32_t K[] =    {       /* Constants defined in SHA-1   */
-                            0x5A827999,
-                            0x6ED9EBA1,
-                            0x8F1BBCDC,
-                            0xCA62C1D6
-                            };
-    int           t;                 /* Loop counter                */
-    uint32_t      temp;              /* Temporary word value        */
-    uint32_t      W[80];             /* Word sequence               */
+    uint32_t      W[16];             /* Word sequence               */
     uint32_t      A, B, C, D, E;     /* Word buffers                */
+    int           t;
 
-    /*
-     *  Initialize the first 16 words in the array W
-     */
-    for(t = 0; t < 16; t++)
+    while (nblocks--)
     {
-        W[t] = context->Message_Block[t * 4] << 24;
-        W[t] |= context->Message_Block[t * 4 + 1] << 16;
-        W[t] |= context->Message_Block[t * 4 + 2] << 8;
-        W[t] |= context->Message_Block[t * 4 + 3];
-    }
+        for(t = 0; t < 16; t++)
+        {
+            W[t] = SHA1LoadWord(data + t * 4);
+        }
 
-    for(t = 16; t < 80; t++)
-    {
-       W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
+        A = H[0];
+        B = H[1];
+        C = H[2];
+        D = H[3];
+        E = H[4];
+
+        SHA1_R5(SHA1_R0, 0)
+        SHA1_R5(SHA1_R0, 5)
+        SHA1_R5(SHA1_R0, 10)
+        SHA1_R0(A,B,C,D,E,15)
+        SHA1_R1(E,A,B,C,D,16) SHA1_R1(D,E,A,B,C,17)
+        SHA1_R1(C,D,E,A,B,18) SHA1_R1(B,C,D,E,A,19)
+
+        SHA1_R5(SHA1_R2, 20)
+        SHA1_R5(SHA1_R2, 25)
+        SHA1_R5(SHA1_R2, 30)
+        SHA1_R5(SHA1_R2, 35)
+
+        SHA1_R5(SHA1_R3, 40)
+        SHA1_R5(SHA1_R3, 45)
+        SHA1_R5(SHA1_R3, 50)
+        SHA1_R5(SHA1_R3, 55)
+
+        SHA1_R5(SHA1_R4, 60)
+        SHA1_R5(SHA1_R4, 65)
+        SHA1_R5(SHA1_R4, 70)
+        SHA1_R5(SHA1_R4, 75)
+
+        H[0] += A;
+        H[1] += B;
+        H[2] += C;
+        H[3] += D;
+        H[4] += E;
+
+        data += 64;
     }
+}
 
-    A = context->Intermediate_Hash[0];
-    B = context->Intermediate_Hash[1];
-    C = context->Intermediate_Hash[2];
-    D = context->Intermediate_Hash[3];
-    E = context->Intermediate_Hash[4];
+#ifdef SHA1_USE_SHANI
+/*
+ *  SHA1ProcessBlocksShaNi
+ *
+ *  Description:
+ *      Compression using the x86 SHA extensions, four rounds per
+ *      sha1rnds4.  Only selected when cpuid reports SHA, SSSE3 and
+ *      SSE4.1, so the target attribute is safe.
+ *
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void SHA1ProcessBlocksShaNi(uint32_t *H,
+                                   const uint8_t *data,
+                                   size_t nblocks)
+{
+    __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+    __m128i MSG0, MSG1, MSG2, MSG3;
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL,
+                                        0x08090a0b0c0d0e0fULL);
 
-    for(t = 0; t < 20; t++)
-    {
-        temp =  SHA1CircularShift(5,A) +
-                ((B & C) | ((~B) & D)) + E + W[t] + K[0];
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
-    }
+    ABCD = _mm_loadu_si128((const __m128i*) H);
+    E0   = _mm_set_epi32((int)H[4], 0, 0, 0);
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
 
-    for(t = 20; t < 40; t++)
+    while (nblocks--)
     {
-        temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        ABCD_SAVE = ABCD;
+        E0_SAVE   = E0;
+
+        /* Rounds 0-3 */
+        MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), MASK);
+        E0   = _mm_add_epi32(E0, MSG0);
+        E1   = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+        /* Rounds 4-7 */
+        MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), MASK);
+        E1   = _mm_sha1nexte_epu32(E1, MSG1);
+        E0   = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+        /* Rounds 8-11 */
+        MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), MASK);
+        E0   = _mm_sha1nexte_epu32(E0, MSG2);
+        E1   = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 12-15 */
+        MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), MASK);
+        E1   = _mm_sha1nexte_epu32(E1, MSG3);
+        E0   = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 16-19 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG0);
+        E1   = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 20-23 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG1);
+        E0   = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 24-27 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG2);
+        E1   = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 28-31 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG3);
+        E0   = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 32-35 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG0);
+        E1   = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 36-39 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG1);
+        E0   = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 40-43 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG2);
+        E1   = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 44-47 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG3);
+        E0   = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 48-51 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG0);
+        E1   = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 52-55 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG1);
+        E0   = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 56-59 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG2);
+        E1   = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+        /* Rounds 60-63 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG3);
+        E0   = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+        /* Rounds 64-67 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG0);
+        E1   = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+        /* Rounds 68-71 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG1);
+        E0   = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+        /* Rounds 72-75 */
+        E0   = _mm_sha1nexte_epu32(E0, MSG2);
+        E1   = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+        /* Rounds 76-79 */
+        E1   = _mm_sha1nexte_epu32(E1, MSG3);
+        E0   = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+        /* Combine state */
+        E0   = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+
+        data += 64;
     }
 
-    for(t = 40; t < 60; t++)
-    {
-        temp = SHA1CircularShift(5,A) +
-               ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
-    }
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    _mm_storeu_si128((__m128i*) H, ABCD);
+    H[4] = (uint32_t)_mm_extract_epi32(E0, 3);
+}
+#endif
+
+/*
+ *  SHA1SelectBlockFunc
+ *
+ *  Description:
+ *      Pick the fastest block function this CPU supports.
+ *
+ */
+static SHA1BlockFunc SHA1SelectBlockFunc(void)
+{
+#ifdef SHA1_USE_SHANI
+    unsigned int eax, ebx, ecx, edx;
 
-    for(t = 60; t < 80; t++)
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+        (ecx & (1u << 9)) && (ecx & (1u << 19)) &&    /* SSSE3, SSE4.1 */
+        __get_cpuid_max(0, NULL) >= 7)
     {
-        temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & (1u << 29))                          /* SHA */
+        {
+            return SHA1ProcessBlocksShaNi;
+        }
     }
-
-    context->Intermediate_Hash[0] += A;
-    context->Intermediate_Hash[1] += B;
-    context->Intermediate_Hash[2] += C;
-    context->Intermediate_Hash[3] += D;
-    context->Intermediate_Hash[4] += E;
-
-    context->Message_Block_Index = 0;
+#endif
+    return SHA1ProcessBlocksGeneric;
 }
 
-
 /*
  *  SHA1PadMessage
  *
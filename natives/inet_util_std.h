@@ -172,6 +172,7 @@ typedef SOCKET socket_t;
 
 #define INET_READ  0x01
 #define INET_WRITE 0x02
+#define INET_ERROR 0x04
 
 
 // util forwards
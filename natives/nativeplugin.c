@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Creation
+//
+
+#include "nativeplugin.h"
+
+#ifndef _WIN32
+ #include <dirent.h>
+ #include <dlfcn.h>
+ #define PLUGIN_DLOPEN
+#endif
+
+#ifndef NATIVE_PLUGIN_MAX
+#define NATIVE_PLUGIN_MAX 16
+#endif
+
+// auto-generated by sedonac in "nativetable.c"
+extern NativeMethod* nativeTable[];
+extern const int nativeTableSize;
+
+typedef struct PluginKit
+{
+  char          name[32];   // kit name the natives belong to
+  int           kitId;      // sedonac native kit id
+  NativeMethod* methods;
+  int           count;
+  bool          installed;  // currently in nativeTable
+} PluginKit;
+
+static PluginKit pluginKits[NATIVE_PLUGIN_MAX];
+static int       pluginKitCount = 0;
+static bool      pluginsLoaded  = FALSE;
+
+////////////////////////////////////////////////////////////////
+// Registration
+////////////////////////////////////////////////////////////////
+
+static int registerKit(const char* kitName, int kitId, NativeMethod* methods, int count)
+{
+  PluginKit* pk;
+  int i;
+
+  if (kitName == NULL || methods == NULL || count <= 0) return -1;
+  if (kitId < 0 || kitId >= nativeTableSize) return -1;
+  if (pluginKitCount >= NATIVE_PLUGIN_MAX) return -1;
+
+  for (i=0; i<pluginKitCount; ++i)
+    if (pluginKits[i].kitId == kitId)
+    {
+      printf("WARNING: native kit %d already registered by plugin (%s)\n", kitId, pluginKits[i].name);
+      return -1;
+    }
+
+  pk = pluginKits + pluginKitCount++;
+  strncpy(pk->name, kitName, sizeof(pk->name)-1);
+  pk->name[sizeof(pk->name)-1] = '\0';
+  pk->kitId     = kitId;
+  pk->methods   = methods;
+  pk->count     = count;
+  pk->installed = FALSE;
+  return 0;
+}
+
+static const NativeRegistry registry = { NATIVE_PLUGIN_VERSION, registerKit };
+
+////////////////////////////////////////////////////////////////
+// Loading
+////////////////////////////////////////////////////////////////
+
+/**
+ * Load every "*.so" in dir and let it register its kits.  Plugins
+ * are loaded once and stay loaded for the life of the process, so
+ * calling this again (platform restart) is a no-op.  Returns the
+ * number of registered kits.
+ */
+int loadNativePlugins(const char* dir)
+{
+#ifdef PLUGIN_DLOPEN
+  DIR* d;
+  struct dirent* e;
+  char path[512];
+
+  if (pluginsLoaded) return pluginKitCount;
+  pluginsLoaded = TRUE;
+
+  d = opendir(dir);
+  if (d == NULL) return 0;
+
+  while ((e = readdir(d)) != NULL)
+  {
+    size_t len = strlen(e->d_name);
+    NativePluginInit init;
+    void* h;
+
+    if (len < 4 || strcmp(e->d_name + len - 3, ".so") != 0) continue;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    h = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (h == NULL)
+    {
+      printf("WARNING: cannot load native plugin: %s\n", dlerror());
+      continue;
+    }
+
+    init = (NativePluginInit)dlsym(h, NATIVE_PLUGIN_INIT);
+    if (init == NULL)
+    {
+      printf("WARNING: native plugin %s has no %s\n", path, NATIVE_PLUGIN_INIT);
+      dlclose(h);
+      continue;
+    }
+
+    if (init(&registry) != 0)
+      printf("WARNING: native plugin %s failed to initialize\n", path);
+  }
+
+  closedir(d);
+#endif
+  return pluginKitCount;
+}
+
+////////////////////////////////////////////////////////////////
+// Install
+////////////////////////////////////////////////////////////////
+
+static bool imageHasKit(SedonaVM* vm, const char* name)
+{
+  const uint8_t* cb = vm->codeBaseAddr;
+  uint16_t kitsBix  = *(uint16_t*)(cb+20);  // see ImageGen.java header()
+  int numKits       = cb[22];
+  const uint16_t* kits = (const uint16_t*)block2addr(cb, kitsBix);
+  int i;
+
+  for (i=0; i<numKits; ++i)
+  {
+    void* kit = (void*)block2addr(cb, kits[i]);
+    if (strcmp((const char*)getKitName(vm, kit), name) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/**
+ * Install registered plugin kits into nativeTable for the image
+ * just loaded into vm.  Kits compiled into the VM always win, and
+ * kits the image doesn't use are left out.  Returns the number of
+ * kits installed.
+ */
+int installNativePlugins(SedonaVM* vm)
+{
+  PluginKit* pk;
+  int n = 0;
+
+  // undo a previous image's install
+  for (pk = pluginKits; pk < pluginKits + pluginKitCount; ++pk)
+    if (pk->installed)
+    {
+      nativeTable[pk->kitId] = NULL;
+      pk->installed = FALSE;
+    }
+
+  for (pk = pluginKits; pk < pluginKits + pluginKitCount; ++pk)
+  {
+    if (nativeTable[pk->kitId] != NULL)
+    {
+      printf("WARNING: native kit %d is built in, ignoring plugin for %s\n", pk->kitId, pk->name);
+      continue;
+    }
+    if (!imageHasKit(vm, pk->name)) continue;
+
+    nativeTable[pk->kitId] = pk->methods;
+    pk->installed = TRUE;
+    n++;
+  }
+  return n;
+}
+
+int isPluginNativeIdValid(int kitId, int methodId)
+{
+  PluginKit* pk;
+
+  for (pk = pluginKits; pk < pluginKits + pluginKitCount; ++pk)
+    if (pk->installed && pk->kitId == kitId)
+      return methodId >= 0 && methodId < pk->count && pk->methods[methodId] != NULL;
+  return 0;
+}
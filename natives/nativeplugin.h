@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Creation
+//
+
+#ifndef __NATIVEPLUGIN_H
+#define __NATIVEPLUGIN_H
+
+// includes
+#include "../svm/sedona.h"
+
+// C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Native kit plugins are shared objects loaded at startup from the
+// plugin directory (see --plugins in main.c).  Each one exports
+//
+//   int sedonaNativeInit(const NativeRegistry* reg)
+//
+// and calls reg->registerKit once per kit it implements, passing the
+// kit's name, its sedonac native kit id and the NativeMethod array in
+// method id order.  A plugin may only claim kit ids that have no
+// table compiled into the VM; registrations for kits that are not in
+// the loaded image are ignored.  Return 0 on success.
+//
+
+#define NATIVE_PLUGIN_VERSION  1
+#define NATIVE_PLUGIN_INIT     "sedonaNativeInit"
+
+typedef struct NativeRegistry
+{
+  int version;   // NATIVE_PLUGIN_VERSION
+  int (*registerKit)(const char* kitName, int kitId, NativeMethod* methods, int count);
+} NativeRegistry;
+
+typedef int (*NativePluginInit)(const NativeRegistry* reg);
+
+// host side
+extern int  loadNativePlugins(const char* dir);
+extern int  installNativePlugins(SedonaVM* vm);
+extern int  isPluginNativeIdValid(int kitId, int methodId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
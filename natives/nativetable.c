@@ -4,6 +4,7 @@
 //
 
 #include "../svm/sedona.h"
+#include "nativeplugin.h"
 
 ////////////////////////////////////////////////////////////////
 // sys (kitId=0)
@@ -189,6 +190,48 @@ Cell sys_PlatformService_getPlatVersion(SedonaVM* vm, Cell* params);
 // long PlatformService.getNativeMemAvailable()
 Cell sys_PlatformService_getNativeMemAvailable(SedonaVM* vm, Cell* params);
 
+// byte[] FileStore.doView(sys::Obj)
+Cell sys_FileStore_doView(SedonaVM* vm, Cell* params);
+
+// int FileStore.doViewLen(sys::Obj)
+Cell sys_FileStore_doViewLen(SedonaVM* vm, Cell* params);
+
+// int FileStore.doStatus(sys::Obj)
+Cell sys_FileStore_doStatus(SedonaVM* vm, Cell* params);
+
+// sys::Obj Component.compileLinks(sys::Component[], sys::Slot[], sys::Component[], sys::Slot[], int)
+Cell sys_Component_compileLinks(SedonaVM* vm, Cell* params);
+
+// int Component.propagateLinks(sys::Obj, bool[])
+Cell sys_Component_propagateLinks(SedonaVM* vm, Cell* params);
+
+// void Component.freeLinks(sys::Obj)
+Cell sys_Component_freeLinks(SedonaVM* vm, Cell* params);
+
+// bool Component.trackChanges(int)
+Cell sys_Component_trackChanges(SedonaVM* vm, Cell* params);
+
+// int Component.drainChanges(sys::Component[], sys::Slot[], int)
+Cell sys_Component_drainChanges(SedonaVM* vm, Cell* params);
+
+// sys::Obj Component.compileSchedule(sys::Component[], int, int)
+Cell sys_Component_compileSchedule(SedonaVM* vm, Cell* params);
+
+// int Component.runSchedule(sys::Obj)
+Cell sys_Component_runSchedule(SedonaVM* vm, Cell* params);
+
+// void Component.freeSchedule(sys::Obj)
+Cell sys_Component_freeSchedule(SedonaVM* vm, Cell* params);
+
+// bool Component.shmOpen(sys::Str, sys::Component[], int[], sys::Slot[], int)
+Cell sys_Component_shmOpen(SedonaVM* vm, Cell* params);
+
+// int Component.shmPublish()
+Cell sys_Component_shmPublish(SedonaVM* vm, Cell* params);
+
+// void Component.shmClose()
+Cell sys_Component_shmClose(SedonaVM* vm, Cell* params);
+
 // native table for kit 0
 NativeMethod kitNatives0[] =
 {
@@ -252,6 +295,20 @@ NativeMethod kitNatives0[] =
   sys_PlatformService_doPlatformId,  // 0::57
   sys_PlatformService_getPlatVersion,  // 0::58
   sys_PlatformService_getNativeMemAvailable,  // 0::59
+  sys_FileStore_doView,           // 0::60
+  sys_FileStore_doViewLen,        // 0::61
+  sys_FileStore_doStatus,         // 0::62
+  sys_Component_compileLinks,     // 0::63
+  sys_Component_propagateLinks,   // 0::64
+  sys_Component_freeLinks,        // 0::65
+  sys_Component_trackChanges,     // 0::66
+  sys_Component_drainChanges,     // 0::67
+  sys_Component_compileSchedule,  // 0::68
+  sys_Component_runSchedule,      // 0::69
+  sys_Component_freeSchedule,     // 0::70
+  sys_Component_shmOpen,          // 0::71
+  sys_Component_shmPublish,       // 0::72
+  sys_Component_shmClose,         // 0::73
 };
 
 ////////////////////////////////////////////////////////////////
@@ -330,6 +387,42 @@ Cell inet_Crypto_sha1(SedonaVM* vm, Cell* params);
 // bool UdpSocket.join()
 Cell inet_UdpSocket_join(SedonaVM* vm, Cell* params);
 
+// sys::Obj Crypto.sha1Init()
+Cell inet_Crypto_sha1Init(SedonaVM* vm, Cell* params);
+
+// void Crypto.sha1Update(sys::Obj, byte[], int, int)
+Cell inet_Crypto_sha1Update(SedonaVM* vm, Cell* params);
+
+// void Crypto.sha1Final(sys::Obj, byte[], int)
+Cell inet_Crypto_sha1Final(SedonaVM* vm, Cell* params);
+
+// int Reactor.open()
+Cell inet_Reactor_open(SedonaVM* vm, Cell* params);
+
+// bool Reactor.watch(int, sys::Obj, int, int)
+Cell inet_Reactor_watch(SedonaVM* vm, Cell* params);
+
+// bool Reactor.unwatch(int, sys::Obj)
+Cell inet_Reactor_unwatch(SedonaVM* vm, Cell* params);
+
+// int Reactor.poll(int, int[], int[], int, int)
+Cell inet_Reactor_poll(SedonaVM* vm, Cell* params);
+
+// void Reactor.close(int)
+Cell inet_Reactor_close(SedonaVM* vm, Cell* params);
+
+// int UdpSocket.sendBatch(inet::UdpDatagram[], int)
+Cell inet_UdpSocket_sendBatch(SedonaVM* vm, Cell* params);
+
+// int UdpSocket.receiveBatch(inet::UdpDatagram[], inet::IpAddr[], int)
+Cell inet_UdpSocket_receiveBatch(SedonaVM* vm, Cell* params);
+
+// int UdpSocket.receiveRing(byte[], int, int, int, int, int[], inet::IpAddr[])
+Cell inet_UdpSocket_receiveRing(SedonaVM* vm, Cell* params);
+
+// int TcpSocket.sendFile(sys::Obj, int, int)
+Cell inet_TcpSocket_sendFile(SedonaVM* vm, Cell* params);
+
 // native table for kit 2
 NativeMethod kitNatives2[] =
 {
@@ -350,6 +443,18 @@ NativeMethod kitNatives2[] =
   inet_UdpSocket_idealPacketSize,  // 2::14
   inet_Crypto_sha1,               // 2::15
   inet_UdpSocket_join,            // 2::16
+  inet_Crypto_sha1Init,           // 2::17
+  inet_Crypto_sha1Update,         // 2::18
+  inet_Crypto_sha1Final,          // 2::19
+  inet_Reactor_open,              // 2::20
+  inet_Reactor_watch,             // 2::21
+  inet_Reactor_unwatch,           // 2::22
+  inet_Reactor_poll,              // 2::23
+  inet_Reactor_close,             // 2::24
+  inet_UdpSocket_sendBatch,       // 2::25
+  inet_UdpSocket_receiveBatch,    // 2::26
+  inet_UdpSocket_receiveRing,     // 2::27
+  inet_TcpSocket_sendFile,        // 2::28
 };
 
 ////////////////////////////////////////////////////////////////
@@ -391,31 +496,32 @@ NativeMethod* nativeTable[] =
   kitNatives9,     // 9
 };
 
+// number of kit ids in nativeTable, empty ones may be filled by plugins
+const int nativeTableSize = sizeof(nativeTable) / sizeof(nativeTable[0]);
+
 ////////////////////////////////////////////////////////////////
 // Native Id Check
 ////////////////////////////////////////////////////////////////
 
-#ifdef SCODE_DEBUG
 int isNativeIdValid(int kitId, int methodId)
 {
   switch(kitId)
   {
     case 0:
-      if (methodId >= 60) return 0;
+      if (methodId >= 74) return 0;
       else return kitNatives0[methodId] != NULL;
     case 1:
       if (methodId >= 3) return 0;
       else return kitNatives1[methodId] != NULL;
     case 2:
-      if (methodId >= 17) return 0;
+      if (methodId >= 29) return 0;
       else return kitNatives2[methodId] != NULL;
     case 9:
       if (methodId >= 3) return 0;
       else return kitNatives9[methodId] != NULL;
     default:
-       return 0;
+       return isPluginNativeIdValid(kitId, methodId);
   }
 }
-#endif
 
 
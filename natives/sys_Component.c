@@ -4,11 +4,66 @@
 //
 // History:
 //   26 Apr 07  Brian Frank  Creation
+//   19 Oct 26  Slot descriptor cache
+//   19 Oct 26  Change journal
+//   19 Oct 26  Run actions with vmCallInline
+//   19 Oct 26  Compiled link table and schedule
 //
 
 #include "../svm/sedona.h"
+#include "sys_Component.h"
 #include "float.h"
 
+//////////////////////////////////////////////////////////////////////////
+// Slot Descriptors
+//////////////////////////////////////////////////////////////////////////
+
+// one descriptor per code block, reset if a new image is loaded
+static const uint8_t* slotDescBase  = NULL;
+static size_t         slotDescCount = 0;
+static SlotDesc*      slotDescs     = NULL;
+static SlotDesc       slotDescTemp;
+
+static void slotDescReset(SedonaVM* vm)
+{
+  free(slotDescs);
+  slotDescBase  = vm->codeBaseAddr;
+  slotDescCount = vm->codeSize / SCODE_BLOCK_SIZE;
+  slotDescs     = (SlotDesc*)calloc(slotDescCount, sizeof(SlotDesc));
+  if (slotDescs == NULL) slotDescCount = 0;
+}
+
+/**
+ * Return the decoded descriptor for a slot.  The table is keyed by
+ * the slot's block index in the image; if it could not be allocated
+ * the slot is decoded into a scratch descriptor on every call.
+ */
+SlotDesc* getSlotDesc(SedonaVM* vm, const uint8_t* slot)
+{
+  size_t block;
+  SlotDesc* d;
+
+  if (slotDescBase != vm->codeBaseAddr)
+    slotDescReset(vm);
+
+  block = (size_t)(slot - vm->codeBaseAddr) / SCODE_BLOCK_SIZE;
+  if (block < slotDescCount)
+  {
+    d = slotDescs + block;
+    if (d->valid) return d;
+  }
+  else
+  {
+    d = &slotDescTemp;
+  }
+
+  d->typeId = getTypeId(vm, getSlotType(vm, (void*)slot));
+  d->handle = getSlotHandle(vm, (void*)slot);
+  d->id     = getByte((void*)slot, 0);
+  d->valid  = 1;
+  return d;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Error Handling
 //////////////////////////////////////////////////////////////////////////
@@ -37,8 +92,9 @@ Cell sys_Component_getBool(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
   Cell ret;
 
   if (typeId != BoolTypeId)
@@ -53,8 +109,9 @@ Cell sys_Component_getInt(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
   Cell ret;
 
   switch (typeId)
@@ -80,8 +137,9 @@ int64_t sys_Component_getLong(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   if (typeId != LongTypeId)
   {
@@ -97,8 +155,9 @@ Cell sys_Component_getFloat(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
   Cell ret;
 
   if (typeId != FloatTypeId)
@@ -114,8 +173,9 @@ int64_t sys_Component_getDouble(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   if (typeId != DoubleTypeId)
   {
@@ -131,8 +191,9 @@ Cell sys_Component_getBuf(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
   Cell ret;
 
   if (typeId != BufTypeId)
@@ -152,8 +213,9 @@ Cell sys_Component_doSetBool(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   uint8_t val     = params[2].ival;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   // type check
   if (typeId != BoolTypeId)
@@ -165,6 +227,7 @@ Cell sys_Component_doSetBool(SedonaVM* vm, Cell* params)
 
   // update memory location
   setByte(self, offset, val);
+  markChanged(self, slot, desc);
   return trueCell;
 }
 
@@ -174,8 +237,9 @@ Cell sys_Component_doSetInt(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
   int32_t val     = params[2].ival;
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   switch (typeId)
   {
@@ -195,6 +259,7 @@ Cell sys_Component_doSetInt(SedonaVM* vm, Cell* params)
       return accessError(vm, "setInt", self, slot);
   }
 
+  markChanged(self, slot, desc);
   return trueCell;
 }
 
@@ -204,8 +269,9 @@ Cell sys_Component_doSetLong(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
   int64_t val     = *(int64_t*)(params+2);
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   // type check
   if (typeId != LongTypeId)
@@ -217,6 +283,7 @@ Cell sys_Component_doSetLong(SedonaVM* vm, Cell* params)
 
   // update memory location
   setWide(self, offset, val);
+  markChanged(self, slot, desc);
   return trueCell;
 }
 
@@ -227,8 +294,9 @@ Cell sys_Component_doSetFloat(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
   Cell newval     = params[2];
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   Cell oldval;
 
@@ -245,6 +313,7 @@ Cell sys_Component_doSetFloat(SedonaVM* vm, Cell* params)
 
   // update memory location
   setFloat(self, offset, newval.fval);
+  markChanged(self, slot, desc);
   return trueCell;
 }
 
@@ -255,8 +324,9 @@ Cell sys_Component_doSetDouble(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   uint8_t* slot   = params[1].aval;
   int64_t val     = *(int64_t*)(params+2);
-  uint16_t typeId = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t offset = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t offset = desc->handle;
 
   // type check
   if (typeId != DoubleTypeId)
@@ -267,6 +337,7 @@ Cell sys_Component_doSetDouble(SedonaVM* vm, Cell* params)
 
   // update memory location
   setWide(self, offset, val);
+  markChanged(self, slot, desc);
   return trueCell;
 }
 
@@ -293,20 +364,28 @@ uint16_t getActionMethod(const uint8_t* cb, const uint8_t* self, const uint16_t
   return ((uint16_t*)block2addr(cb, *(uint16_t*)self))[vidx];
 }
 
+// run the action in the caller's interpreter loop when possible
+static void callAction(SedonaVM* vm, uint16_t method, Cell* args, int argc)
+{
+  if (!vmCallInline(vm, method, args, argc))
+    vm->call(vm, method, args, argc);
+}
+
 // void Component.invokeVoid(Slot)
 Cell sys_Component_invokeVoid(SedonaVM* vm, Cell* params)
 {
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[1];
 
   if (typeId != VoidTypeId)
     return accessError(vm, "invokeVoid", self, slot);
 
   args[0].aval = self;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 1);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 1);
 
   return nullCell;
 }
@@ -317,8 +396,9 @@ Cell sys_Component_invokeBool(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   uint8_t val     = params[2].ival;
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[2];
 
   if (typeId != BoolTypeId)
@@ -326,7 +406,7 @@ Cell sys_Component_invokeBool(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   args[1].ival = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
 
   return nullCell;
 }
@@ -337,8 +417,9 @@ Cell sys_Component_invokeInt(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   int32_t val     = params[2].ival;
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[2];
 
   if (typeId != IntTypeId)
@@ -346,7 +427,7 @@ Cell sys_Component_invokeInt(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   args[1].ival = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
 
   return nullCell;
 }
@@ -357,8 +438,9 @@ Cell sys_Component_invokeLong(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   int64_t val     = *(int64_t*)(params+2);
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[3];
 
   if (typeId != LongTypeId)
@@ -366,7 +448,7 @@ Cell sys_Component_invokeLong(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   *(int64_t*)(args+1) = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 3);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 3);
 
   return nullCell;
 }
@@ -377,8 +459,9 @@ Cell sys_Component_invokeFloat(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   float val       = params[2].fval;
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[2];
 
   if (typeId != FloatTypeId)
@@ -386,7 +469,7 @@ Cell sys_Component_invokeFloat(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   args[1].fval = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
 
   return nullCell;
 }
@@ -397,8 +480,9 @@ Cell sys_Component_invokeDouble(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   int64_t val     = *(int64_t*)(params+2);
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[3];
 
   if (typeId != DoubleTypeId)
@@ -406,7 +490,7 @@ Cell sys_Component_invokeDouble(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   *(int64_t*)(args+1) = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 3);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 3);
 
   return nullCell;
 }
@@ -417,8 +501,9 @@ Cell sys_Component_invokeBuf(SedonaVM* vm, Cell* params)
   uint8_t* self   = params[0].aval;
   void* slot      = params[1].aval;
   uint8_t* val    = params[2].aval;
-  int typeId      = getTypeId(vm, getSlotType(vm, slot));
-  uint16_t vidx   = getSlotHandle(vm, slot);
+  SlotDesc* desc  = getSlotDesc(vm, slot);
+  uint16_t typeId = desc->typeId;
+  uint16_t vidx   = desc->handle;
   Cell args[2];
 
   if (typeId != BufTypeId)
@@ -426,9 +511,542 @@ Cell sys_Component_invokeBuf(SedonaVM* vm, Cell* params)
 
   args[0].aval = self;
   args[1].aval = val;
-  vm->call(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
+  callAction(vm, getActionMethod(vm->codeBaseAddr, self, vidx), args, 2);
+
+  return nullCell;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Change Journal
+//////////////////////////////////////////////////////////////////////////
+
+//
+// Each changed component gets a 256-bit dirty mask (one bit per slot
+// id) in an open addressed table keyed by address, and the first
+// change to a slot since the last drain appends (component, slot) to
+// a bounded FIFO journal.  Everything runs on the VM thread.  If the
+// journal fills up recording stops and the next drain reports an
+// overflow so the consumer falls back to a full rescan.
+//
+// The journal holds raw component pointers; consumers should drain
+// before deleting components or ignore components they don't know.
+//
+
+typedef struct DirtyComp
+{
+  uint8_t* comp;
+  uint32_t bits[8];
+} DirtyComp;
+
+typedef struct Change
+{
+  uint8_t*       comp;
+  const uint8_t* slot;
+  DirtyComp*     dirty;
+  uint8_t        slotId;
+} Change;
+
+bool changeTracking = FALSE;
+
+static Change*    journal      = NULL;
+static int32_t    journalCap   = 0;
+static int32_t    journalHead  = 0;   // oldest entry
+static int32_t    journalCount = 0;
+static bool       journalOverflow = FALSE;
+static DirtyComp* dirtyComps   = NULL;
+static uint32_t   dirtyMask    = 0;
+static int32_t    dirtyUsed    = 0;
+
+static void journalClear()
+{
+  journalHead     = 0;
+  journalCount    = 0;
+  journalOverflow = FALSE;
+  dirtyUsed       = 0;
+  if (dirtyComps != NULL)
+    memset(dirtyComps, 0, (dirtyMask + 1) * sizeof(DirtyComp));
+}
+
+static DirtyComp* dirtyLookup(uint8_t* comp)
+{
+  uint32_t i = (uint32_t)(((uintptr_t)comp >> 2) * 2654435761u) & dirtyMask;
+  DirtyComp* d;
+
+  for (;;)
+  {
+    d = dirtyComps + i;
+    if (d->comp == comp) return d;
+    if (d->comp == NULL) break;
+    i = (i + 1) & dirtyMask;
+  }
+
+  // table is sized 2x the journal, so it can only fill if partial
+  // drains leave stale masks behind; treat that as an overflow
+  if (dirtyUsed >= journalCap) return NULL;
+  dirtyUsed++;
+  d->comp = comp;
+  return d;
+}
+
+void recordChange(uint8_t* comp, const uint8_t* slot, uint8_t slotId)
+{
+  uint32_t bit = 1u << (slotId & 31);
+  DirtyComp* d;
+  Change* c;
+
+  if (journalOverflow) return;
+
+  d = dirtyLookup(comp);
+  if (d == NULL || journalCount >= journalCap)
+  {
+    journalOverflow = TRUE;
+    return;
+  }
+
+  if (d->bits[slotId >> 5] & bit) return;
+  d->bits[slotId >> 5] |= bit;
+
+  c = journal + (journalHead + journalCount) % journalCap;
+  c->comp   = comp;
+  c->slot   = slot;
+  c->dirty  = d;
+  c->slotId = slotId;
+  journalCount++;
+}
+
+// bool Component.trackChanges(int)
+Cell sys_Component_trackChanges(SedonaVM* vm, Cell* params)
+{
+  int32_t cap = params[0].ival;
+  uint32_t size = 1;
+
+  changeTracking = FALSE;
+  free(journal);
+  free(dirtyComps);
+  journal    = NULL;
+  dirtyComps = NULL;
+  journalCap = 0;
+  dirtyMask  = 0;
+
+  if (cap <= 0) return trueCell;
+
+  while (size < (uint32_t)cap * 2) size <<= 1;
+  journal    = (Change*)malloc(cap * sizeof(Change));
+  dirtyComps = (DirtyComp*)malloc(size * sizeof(DirtyComp));
+  if (journal == NULL || dirtyComps == NULL)
+  {
+    free(journal);
+    free(dirtyComps);
+    journal    = NULL;
+    dirtyComps = NULL;
+    return falseCell;
+  }
+
+  journalCap = cap;
+  dirtyMask  = size - 1;
+  journalClear();
+  changeTracking = TRUE;
+  return trueCell;
+}
+
+// int Component.drainChanges(Component[], Slot[], int)
+Cell sys_Component_drainChanges(SedonaVM* vm, Cell* params)
+{
+  void**  comps = (void**)params[0].aval;
+  void**  slots = (void**)params[1].aval;
+  int32_t max   = params[2].ival;
+  int32_t n = 0;
+  Cell ret;
+
+  if (journalOverflow)
+  {
+    journalClear();
+    return negOneCell;
+  }
+
+  while (n < max && journalCount > 0)
+  {
+    Change* c = journal + journalHead;
+    c->dirty->bits[c->slotId >> 5] &= ~(1u << (c->slotId & 31));
+    comps[n] = c->comp;
+    slots[n] = (void*)c->slot;
+    n++;
+    journalHead = (journalHead + 1) % journalCap;
+    journalCount--;
+  }
+
+  if (journalCount == 0 && dirtyUsed > 0)
+    journalClear();
+
+  ret.ival = n;
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Links
+//////////////////////////////////////////////////////////////////////////
+
+//
+// A compiled link table resolves every (from, fromSlot, to, toSlot)
+// tuple once into raw field addresses and a copy kind, then groups
+// consecutive links of the same kind into runs.  Propagation walks
+// the runs in order (so chained links still see upstream values from
+// the same pass) with one tight loop per kind.  Changes are detected
+// exactly like get<Type> followed by doSet<Type>; the caller is
+// responsible for firing changed() on the flagged destinations and
+// for recompiling whenever links or components are added/removed.
+//
+
+#define LINK_SKIP     0   // incompatible slots, never propagated
+#define LINK_COPY8    1   // bool->bool, byte->byte
+#define LINK_COPY16   2   // short->short
+#define LINK_COPY32   3   // int->int, float->float (bitwise like doSetFloat)
+#define LINK_COPY64   4   // long->long, double->double
+#define LINK_CONVERT  5   // mixed byte/short/int, via getInt/doSetInt rules
+
+typedef struct LinkEntry
+{
+  uint8_t* from;      // address of source field
+  uint8_t* to;        // address of destination field
+  uint8_t* toComp;    // for the change journal
+  uint8_t* toSlot;
+  uint8_t  toSlotId;
+  uint8_t  fromType;  // only used by LINK_CONVERT
+  uint8_t  toType;
+} LinkEntry;
+
+typedef struct LinkRun
+{
+  uint8_t  kind;
+  int32_t  start;
+  int32_t  count;
+} LinkRun;
 
+typedef struct LinkTable
+{
+  int32_t    count;
+  int32_t    runCount;
+  LinkEntry* entries;
+  LinkRun*   runs;
+} LinkTable;
+
+#define markLinkChanged(e) \
+  do { if (changeTracking) recordChange((e)->toComp, (e)->toSlot, (e)->toSlotId); } while (0)
+
+static int linkKind(int fromType, int toType)
+{
+  int fromInt = fromType == ByteTypeId || fromType == ShortTypeId || fromType == IntTypeId;
+  int toInt   = toType   == ByteTypeId || toType   == ShortTypeId || toType   == IntTypeId;
+
+  if (fromInt && toInt)
+  {
+    if (fromType != toType) return LINK_CONVERT;
+    if (toType == ByteTypeId)  return LINK_COPY8;
+    if (toType == ShortTypeId) return LINK_COPY16;
+    return LINK_COPY32;
+  }
+
+  if (fromType != toType) return LINK_SKIP;
+  switch (toType)
+  {
+    case BoolTypeId:   return LINK_COPY8;
+    case FloatTypeId:  return LINK_COPY32;
+    case LongTypeId:
+    case DoubleTypeId: return LINK_COPY64;
+  }
+  return LINK_SKIP;
+}
+
+static int32_t linkGetInt(uint8_t* p, int typeId)
+{
+  switch (typeId)
+  {
+    case ByteTypeId:  return *p;
+    case ShortTypeId: return *(uint16_t*)p;
+    default:          return *(int32_t*)p;
+  }
+}
+
+// same compare-then-store as doSetInt, including its truncation
+static bool linkSetInt(uint8_t* p, int typeId, int32_t val)
+{
+  switch (typeId)
+  {
+    case ByteTypeId:
+      if (*p == val) return FALSE;
+      *p = (uint8_t)val;
+      return TRUE;
+    case ShortTypeId:
+      if (*(uint16_t*)p == val) return FALSE;
+      *(uint16_t*)p = (uint16_t)val;
+      return TRUE;
+    default:
+      if (*(int32_t*)p == val) return FALSE;
+      *(int32_t*)p = val;
+      return TRUE;
+  }
+}
+
+// Obj Component.compileLinks(Component[], Slot[], Component[], Slot[], int)
+Cell sys_Component_compileLinks(SedonaVM* vm, Cell* params)
+{
+  void**   fromComps = (void**)params[0].aval;
+  void**   fromSlots = (void**)params[1].aval;
+  void**   toComps   = (void**)params[2].aval;
+  void**   toSlots   = (void**)params[3].aval;
+  int32_t  count     = params[4].ival;
+  LinkTable* t;
+  LinkRun* run = NULL;
+  int32_t i;
+  Cell ret;
+
+  if (count < 0) count = 0;
+
+  t = (LinkTable*)malloc(sizeof(LinkTable) +
+                         count * (sizeof(LinkEntry) + sizeof(LinkRun)));
+  if (t == NULL) return nullCell;
+
+  t->count    = count;
+  t->runCount = 0;
+  t->entries  = (LinkEntry*)(t + 1);
+  t->runs     = (LinkRun*)(t->entries + count);
+
+  for (i=0; i<count; ++i)
+  {
+    uint8_t*  from = (uint8_t*)fromComps[i];
+    uint8_t*  to   = (uint8_t*)toComps[i];
+    SlotDesc* fd   = getSlotDesc(vm, (uint8_t*)fromSlots[i]);
+    uint8_t   fromType = fd->typeId;
+    uint16_t  fromOff  = fd->handle;
+    SlotDesc* td   = getSlotDesc(vm, (uint8_t*)toSlots[i]);
+    LinkEntry* e   = t->entries + i;
+    int kind       = linkKind(fromType, td->typeId);
+
+    if (from == NULL || to == NULL) kind = LINK_SKIP;
+    else if (kind == LINK_SKIP) accessError(vm, "compileLinks", to, toSlots[i]);
+
+    e->from     = kind == LINK_SKIP ? NULL : from + fromOff;
+    e->to       = kind == LINK_SKIP ? NULL : to + td->handle;
+    e->toComp   = to;
+    e->toSlot   = (uint8_t*)toSlots[i];
+    e->toSlotId = td->id;
+    e->fromType = fromType;
+    e->toType   = td->typeId;
+
+    if (run == NULL || run->kind != kind)
+    {
+      run = t->runs + t->runCount++;
+      run->kind  = (uint8_t)kind;
+      run->start = i;
+      run->count = 0;
+    }
+    run->count++;
+  }
+
+  ret.aval = t;
+  return ret;
+}
+
+// int Component.propagateLinks(Obj, bool[])
+Cell sys_Component_propagateLinks(SedonaVM* vm, Cell* params)
+{
+  LinkTable* t    = (LinkTable*)params[0].aval;
+  uint8_t* change = (uint8_t*)params[1].aval;
+  uint8_t  scratch;
+  int32_t  total = 0;
+  int32_t  r;
+  Cell ret;
+
+  if (t == NULL) return zeroCell;
+
+  for (r=0; r<t->runCount; ++r)
+  {
+    LinkRun*   run = t->runs + r;
+    LinkEntry* e   = t->entries + run->start;
+    LinkEntry* end = e + run->count;
+    uint8_t*   c   = change != NULL ? change + run->start : &scratch;
+    int        step = change != NULL;
+
+    switch (run->kind)
+    {
+      case LINK_COPY8:
+        for (; e<end; ++e, c+=step)
+        {
+          uint8_t v = *e->from;
+          *c = *e->to != v;
+          *e->to = v;
+          if (*c) { total++; markLinkChanged(e); }
+        }
+        break;
+
+      case LINK_COPY16:
+        for (; e<end; ++e, c+=step)
+        {
+          uint16_t v = *(uint16_t*)e->from;
+          *c = *(uint16_t*)e->to != v;
+          *(uint16_t*)e->to = v;
+          if (*c) { total++; markLinkChanged(e); }
+        }
+        break;
+
+      case LINK_COPY32:
+        for (; e<end; ++e, c+=step)
+        {
+          int32_t v = *(int32_t*)e->from;
+          *c = *(int32_t*)e->to != v;
+          *(int32_t*)e->to = v;
+          if (*c) { total++; markLinkChanged(e); }
+        }
+        break;
+
+      case LINK_COPY64:
+        for (; e<end; ++e, c+=step)
+        {
+          int64_t v = *(int64_t*)e->from;
+          *c = *(int64_t*)e->to != v;
+          *(int64_t*)e->to = v;
+          if (*c) { total++; markLinkChanged(e); }
+        }
+        break;
+
+      case LINK_CONVERT:
+        for (; e<end; ++e, c+=step)
+        {
+          *c = linkSetInt(e->to, e->toType, linkGetInt(e->from, e->fromType));
+          if (*c) { total++; markLinkChanged(e); }
+        }
+        break;
+
+      default:
+        if (change != NULL) memset(c, 0, run->count);
+        break;
+    }
+  }
+
+  ret.ival = total;
+  return ret;
+}
+
+// void Component.freeLinks(Obj)
+Cell sys_Component_freeLinks(SedonaVM* vm, Cell* params)
+{
+  free(params[0].aval);
   return nullCell;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Schedule
+//////////////////////////////////////////////////////////////////////////
+
+//
+// A compiled schedule is the app's execute order flattened into an
+// array of (component, method block) pairs, with the virtual call
+// resolved once at compile time.  The scan then runs from C with one
+// interpreter entry per component and no tree walk.  Sedona code
+// recompiles whenever components are added, removed or reordered.
+//
+// vidx is the vtable index of the method to run (Component.execute);
+// it is the same for every component since vtables only append.
+//
+
+typedef struct ScheduleEntry
+{
+  void*    comp;
+  uint16_t method;
+} ScheduleEntry;
+
+typedef struct Schedule
+{
+  int32_t       count;
+  ScheduleEntry entries[1];
+} Schedule;
+
+// Obj Component.compileSchedule(Component[], int, int)
+Cell sys_Component_compileSchedule(SedonaVM* vm, Cell* params)
+{
+  void**  comps = (void**)params[0].aval;
+  int32_t count = params[1].ival;
+  int32_t vidx  = params[2].ival;
+  const uint8_t* cb = vm->codeBaseAddr;
+  uint16_t lastVtable = 0;
+  uint16_t lastMethod = 0;
+  Schedule* s;
+  int32_t i, n = 0;
+  Cell ret;
+
+  if (count < 0) count = 0;
+
+  s = (Schedule*)malloc(sizeof(Schedule) + count * sizeof(ScheduleEntry));
+  if (s == NULL) return nullCell;
 
+  for (i=0; i<count; ++i)
+  {
+    uint8_t* comp = (uint8_t*)comps[i];
+    uint16_t vtable;
+
+    if (comp == NULL) continue;
+
+    // runs of the same type are common, skip the vtable lookup
+    vtable = *(uint16_t*)comp;
+    if (vtable != lastVtable)
+    {
+      lastVtable = vtable;
+      lastMethod = getActionMethod(cb, comp, (uint16_t)vidx);
+    }
+
+    s->entries[n].comp   = comp;
+    s->entries[n].method = lastMethod;
+    n++;
+  }
+  s->count = n;
+
+  ret.aval = s;
+  return ret;
+}
+
+// int Component.runSchedule(Obj)
+//
+// Returns the number of entries run, or the negated error code of
+// the first call that failed; the rest of the schedule is skipped.
+Cell sys_Component_runSchedule(SedonaVM* vm, Cell* params)
+{
+  Schedule* s = (Schedule*)params[0].aval;
+  Cell* sp = vm->sp;
+  ScheduleEntry* e;
+  ScheduleEntry* end;
+  Cell args[1];
+  Cell ret;
+  int result;
+
+  if (s == NULL) return zeroCell;
+
+  end = s->entries + s->count;
+  for (e = s->entries; e < end; ++e)
+  {
+    // a void method returns the cell below its args, make that 0
+    // so anything else is an error code
+    sp->ival = 0;
+    args[0].aval = e->comp;
+    result = vm->call(vm, e->method, args, 1);
+
+    // natives run by the call leave vm->sp inside its frames
+    vm->sp = sp;
+
+    if (result != 0)
+    {
+      ret.ival = -result;
+      return ret;
+    }
+  }
+
+  ret.ival = s->count;
+  return ret;
+}
+
+// void Component.freeSchedule(Obj)
+Cell sys_Component_freeSchedule(SedonaVM* vm, Cell* params)
+{
+  free(params[0].aval);
+  return nullCell;
+}
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Slot descriptor cache
+//   19 Oct 26  Change journal
+//
+
+#ifndef __SYS_COMPONENT_H
+#define __SYS_COMPONENT_H
+
+// includes
+#include "../svm/sedona.h"
+
+// C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Decoded form of a sys::Slot.  One descriptor exists per code
+// block of the loaded image and is filled the first time the slot
+// at that block is touched, so repeated reflective access costs a
+// single indexed load instead of walking Slot -> Type in scode.
+//
+// For properties handle is the field offset in the component;
+// for actions it is the vtable index of the action method.
+//
+typedef struct SlotDesc
+{
+  uint8_t  typeId;   // primitive type id of the slot's type
+  uint8_t  valid;    // nonzero once decoded
+  uint16_t handle;   // field offset or vtable index
+  uint8_t  id;       // slot id within its type
+} SlotDesc;
+
+extern SlotDesc* getSlotDesc(SedonaVM* vm, const uint8_t* slot);
+extern uint16_t  getActionMethod(const uint8_t* cb, const uint8_t* self, const uint16_t vidx);
+
+//
+// Change journal, see Component.trackChanges.  When enabled every
+// setter that actually changes a value records (component, slot)
+// once until it is drained.
+//
+extern bool changeTracking;
+extern void recordChange(uint8_t* comp, const uint8_t* slot, uint8_t slotId);
+
+#define markChanged(comp, slot, desc) \
+  do { if (changeTracking) recordChange(comp, slot, (desc)->id); } while (0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
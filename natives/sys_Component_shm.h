@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Creation
+//
+
+#ifndef __SYS_COMPONENT_SHM_H
+#define __SYS_COMPONENT_SHM_H
+
+//
+// Layout of the shared-memory property export, see
+// Component.shmOpen in sys_Component_std.c.  This header only
+// depends on <stdint.h> so external readers can include it.
+//
+//   ShmHeader
+//   ShmPoint[count]        at header.pointsOffset
+//   value area             at header.valuesOffset
+//
+// Values are stored little/big endian as the VM host, each aligned
+// to its own size at ShmPoint.offset from the value area.  The VM
+// rewrites the whole value area once per publish under a seqlock:
+// header.seq is odd while a publish is in progress.  A reader does
+//
+//   do {
+//     s = shmReadBegin(hdr);
+//     ... copy values ...
+//   } while (shmReadRetry(hdr, s));
+//
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHM_MAGIC    0x53564d53   // "SVMS"
+#define SHM_VERSION  1
+#define SHM_NAME_LEN 32
+
+typedef struct ShmHeader
+{
+  uint32_t magic;          // SHM_MAGIC
+  uint16_t version;        // SHM_VERSION
+  uint16_t pointSize;      // sizeof(ShmPoint)
+  uint32_t count;          // number of points
+  uint32_t pointsOffset;   // byte offset of ShmPoint table
+  uint32_t valuesOffset;   // byte offset of value area
+  uint32_t valuesSize;     // bytes in value area
+  volatile uint32_t seq;   // seqlock, odd while writing
+  uint32_t reserved;
+  volatile uint64_t scans; // number of completed publishes
+} ShmHeader;
+
+typedef struct ShmPoint
+{
+  int32_t  compId;         // component id supplied by the app
+  uint8_t  slotId;         // slot id within the component's type
+  uint8_t  typeId;         // sys::Type id (BoolTypeId, IntTypeId...)
+  uint16_t size;           // value size in bytes
+  uint32_t offset;         // offset of value in value area
+  char     name[SHM_NAME_LEN];  // slot name, NUL terminated
+} ShmPoint;
+
+#define shmPoints(hdr)  ((ShmPoint*)((uint8_t*)(hdr) + (hdr)->pointsOffset))
+#define shmValues(hdr)  ((uint8_t*)(hdr) + (hdr)->valuesOffset)
+
+static inline uint32_t shmReadBegin(const ShmHeader* hdr)
+{
+  uint32_t s;
+  while ((s = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE)) & 1) {}
+  return s;
+}
+
+static inline int shmReadRetry(const ShmHeader* hdr, uint32_t s)
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != s;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2007 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Creation
+//
+
+#include "../svm/sedona.h"
+#include "sys_Component.h"
+#include "sys_Component_shm.h"
+
+#ifndef _WIN32
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <sys/mman.h>
+ #define SHM_POSIX
+#endif
+
+//
+// Shared-memory export of component properties.  The app picks a set
+// of (component, slot) points once with shmOpen; every shmPublish then
+// copies their current values into a named POSIX shared-memory segment
+// under a seqlock so local HMIs and collectors can sample them without
+// going through Sox or the VM.  See sys_Component_shm.h for the layout.
+//
+// Only one export is open at a time.  Component memory is mirrored, not
+// moved, so the app must shmClose (or reopen) before deleting a point's
+// component.  On platforms without POSIX shm shmOpen returns false.
+//
+
+typedef struct ShmSource
+{
+  uint8_t* addr;    // address of the value in the component
+  uint8_t* dest;    // address of the value in the segment
+  uint16_t size;
+} ShmSource;
+
+static ShmHeader* shmHdr     = NULL;
+static size_t     shmSize    = 0;
+static ShmSource* shmSources = NULL;
+static char       shmName[64];
+
+Cell sys_Component_shmPublish(SedonaVM* vm, Cell* params);
+
+static uint16_t shmValueSize(int typeId)
+{
+  switch (typeId)
+  {
+    case BoolTypeId:
+    case ByteTypeId:   return 1;
+    case ShortTypeId:  return 2;
+    case IntTypeId:
+    case FloatTypeId:  return 4;
+    case LongTypeId:
+    case DoubleTypeId: return 8;
+  }
+  return 0;
+}
+
+static void shmRelease()
+{
+#ifdef SHM_POSIX
+  if (shmHdr != NULL)
+  {
+    munmap(shmHdr, shmSize);
+    shm_unlink(shmName);
+  }
+#endif
+  free(shmSources);
+  shmHdr     = NULL;
+  shmSize    = 0;
+  shmSources = NULL;
+}
+
+// bool Component.shmOpen(Str, Component[], int[], Slot[], int)
+Cell sys_Component_shmOpen(SedonaVM* vm, Cell* params)
+{
+#ifdef SHM_POSIX
+  const char* name  = (const char*)params[0].aval;
+  void**      comps = (void**)params[1].aval;
+  int32_t*    ids   = (int32_t*)params[2].aval;
+  void**      slots = (void**)params[3].aval;
+  int32_t     count = params[4].ival;
+  uint32_t pointsOffset, valuesOffset, valuesSize = 0;
+  ShmPoint* points;
+  uint8_t*  values;
+  int32_t i;
+  int fd;
+
+  shmRelease();
+  if (count < 0) count = 0;
+
+  // shm names must start with a single slash
+  snprintf(shmName, sizeof(shmName), "%s%s", name[0] == '/' ? "" : "/", name);
+
+  shmSources = (ShmSource*)calloc(count > 0 ? count : 1, sizeof(ShmSource));
+  if (shmSources == NULL) return falseCell;
+
+  // lay out values, each aligned to its own size
+  for (i=0; i<count; ++i)
+  {
+    SlotDesc* desc = getSlotDesc(vm, (uint8_t*)slots[i]);
+    uint16_t size  = shmValueSize(desc->typeId);
+    if (size == 0 || comps[i] == NULL) continue;
+    valuesSize = (valuesSize + size - 1) & ~(uint32_t)(size - 1);
+    shmSources[i].addr = (uint8_t*)comps[i] + desc->handle;
+    shmSources[i].dest = (uint8_t*)(uintptr_t)valuesSize;  // fixed up below
+    shmSources[i].size = size;
+    valuesSize += size;
+  }
+
+  pointsOffset = (sizeof(ShmHeader) + 7) & ~7u;
+  valuesOffset = (pointsOffset + count * sizeof(ShmPoint) + 7) & ~7u;
+  shmSize = valuesOffset + valuesSize;
+
+  fd = shm_open(shmName, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0) { shmRelease(); return falseCell; }
+  if (ftruncate(fd, shmSize) != 0)
+  {
+    close(fd);
+    shm_unlink(shmName);
+    shmRelease();
+    return falseCell;
+  }
+  shmHdr = (ShmHeader*)mmap(NULL, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shmHdr == MAP_FAILED)
+  {
+    shmHdr = NULL;
+    shm_unlink(shmName);
+    shmRelease();
+    return falseCell;
+  }
+
+  points = (ShmPoint*)((uint8_t*)shmHdr + pointsOffset);
+  values = (uint8_t*)shmHdr + valuesOffset;
+  for (i=0; i<count; ++i)
+  {
+    ShmPoint*  p = points + i;
+    ShmSource* s = shmSources + i;
+    SlotDesc*  desc = getSlotDesc(vm, (uint8_t*)slots[i]);
+
+    p->compId = ids != NULL ? ids[i] : i;
+    p->slotId = desc->id;
+    p->typeId = desc->typeId;
+    p->size   = s->size;
+    p->offset = (uint32_t)(uintptr_t)s->dest;
+    strncpy(p->name, (const char*)getSlotName(vm, slots[i]), SHM_NAME_LEN-1);
+    p->name[SHM_NAME_LEN-1] = '\0';
+
+    if (s->size > 0) s->dest = values + p->offset;
+  }
+
+  shmHdr->version      = SHM_VERSION;
+  shmHdr->pointSize    = sizeof(ShmPoint);
+  shmHdr->count        = count;
+  shmHdr->pointsOffset = pointsOffset;
+  shmHdr->valuesOffset = valuesOffset;
+  shmHdr->valuesSize   = valuesSize;
+  shmHdr->seq          = 0;
+  shmHdr->scans        = 0;
+
+  // magic last so readers never see a half built descriptor
+  __atomic_store_n(&shmHdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+  sys_Component_shmPublish(vm, NULL);
+  return trueCell;
+#else
+  return falseCell;
+#endif
+}
+
+// int Component.shmPublish()
+Cell sys_Component_shmPublish(SedonaVM* vm, Cell* params)
+{
+  ShmSource* s;
+  ShmSource* end;
+  uint32_t seq;
+  Cell ret;
+
+  if (shmHdr == NULL) return negOneCell;
+
+  seq = shmHdr->seq;
+  __atomic_store_n(&shmHdr->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  end = shmSources + shmHdr->count;
+  for (s = shmSources; s < end; ++s)
+  {
+    switch (s->size)
+    {
+      case 1: *s->dest = *s->addr; break;
+      case 2: *(uint16_t*)s->dest = *(uint16_t*)s->addr; break;
+      case 4: *(uint32_t*)s->dest = *(uint32_t*)s->addr; break;
+      case 8: *(uint64_t*)s->dest = *(uint64_t*)s->addr; break;
+    }
+  }
+
+  shmHdr->scans++;
+  __atomic_store_n(&shmHdr->seq, seq + 2, __ATOMIC_RELEASE);
+
+  ret.ival = (int32_t)shmHdr->count;
+  return ret;
+}
+
+// void Component.shmClose()
+Cell sys_Component_shmClose(SedonaVM* vm, Cell* params)
+{
+  shmRelease();
+  return nullCell;
+}
@@ -0,0 +1,602 @@
+//
+// Copyright (c) 2009 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  Write-behind backend for FileStore
+//   19 Oct 26  Asynchronous close
+//
+
+#include "../svm/sedona.h"
+#include "sys_FileStore_std.h"
+
+#ifdef FS_USE_WRITE_BEHIND
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+//
+// Write-behind for files opened in 'w' mode.
+//
+// The VM thread only copies into a per-handle staging buffer;
+// contiguous writes coalesce there.  Full stages, flushes and
+// closes are queued to one of a small pool of worker threads
+// (handles are pinned to a worker so their writes stay ordered).
+// A worker takes its whole queue as one batch: all writes first,
+// then one fdatasync per file that hit a durability point, then
+// any closes.
+//
+// With FS_USE_IO_URING (needs liburing) a worker submits each
+// batch through its own ring instead of one pwrite per request,
+// falling back to pwrite if the ring can't be set up.
+//
+// Errors are sticky per handle: the first failed write makes
+// later writes and doClose return false, and doStatus reports it.
+// doClose only queues the close and returns; the handle is parked
+// on a closing list until its worker is done with it.  Errors that
+// show up after that are reported by the next doStatus(null), and
+// fsWbSettle waits for a file's closes where the file has to be
+// complete on disk: before it is opened, sized or renamed (the
+// platform swaps its .stage files in by renaming them).
+//
+
+#ifdef FS_USE_IO_URING
+ #include <liburing.h>
+#endif
+
+#ifndef FS_WB_THREADS
+#define FS_WB_THREADS     2
+#endif
+
+#ifndef FS_WB_STAGE_SIZE
+#define FS_WB_STAGE_SIZE  (64 * 1024)
+#endif
+
+// queued bytes per worker before writers are made to wait
+#ifndef FS_WB_MAX_QUEUED
+#define FS_WB_MAX_QUEUED  (8 * 1024 * 1024)
+#endif
+
+#ifndef FS_WB_RING_ENTRIES
+#define FS_WB_RING_ENTRIES 64
+#endif
+
+#define WB_WRITE  0
+#define WB_SYNC   1
+#define WB_CLOSE  2
+
+typedef struct WbReq
+{
+  struct WbReq*       next;
+  int                 kind;
+  struct WriteBehind* wb;
+  uint8_t*            buf;   // owned by the request
+  size_t              len;
+  off_t               off;
+} WbReq;
+
+typedef struct WbQueue
+{
+  pthread_mutex_t lock;
+  pthread_cond_t  ready;     // worker waits for requests
+  pthread_cond_t  drained;   // writers wait for room
+  WbReq*          head;
+  WbReq*          tail;
+  size_t          queued;    // bytes in queue
+  bool            stopping;
+  pthread_t       thread;
+#ifdef FS_USE_IO_URING
+  struct io_uring ring;
+  bool            useRing;
+#endif
+} WbQueue;
+
+typedef struct WriteBehind
+{
+  int      fd;
+  char*    name;       // path opened, to match closes in fsWbSettle
+  WbQueue* q;
+  uint8_t* stage;      // coalescing buffer
+  size_t   stageLen;
+  off_t    stageOff;   // file offset of stage[0]
+  off_t    pos;        // logical write position
+  int      pending;    // queued requests not yet completed
+  int      error;      // first errno reported by a worker
+  bool     closed;     // set by the worker once the fd is closed
+  struct WriteBehind* nextClosing;  // closing list, see fsWbClose
+} WriteBehind;
+
+static WbQueue queues[FS_WB_THREADS];
+static int nextQueue = 0;
+static pthread_once_t startOnce = PTHREAD_ONCE_INIT;
+static bool started = FALSE;
+
+// closed handles whose close is still queued, VM thread only
+static WriteBehind* closing = NULL;
+static int closeError = 0;     // first errno of a finished close, until reported
+
+static void* workerRun(void* arg);
+
+////////////////////////////////////////////////////////////////
+// Pool
+////////////////////////////////////////////////////////////////
+
+static void stopWorkers()
+{
+  int i;
+
+  for (i=0; i<FS_WB_THREADS; ++i)
+  {
+    pthread_mutex_lock(&queues[i].lock);
+    queues[i].stopping = TRUE;
+    pthread_cond_signal(&queues[i].ready);
+    pthread_mutex_unlock(&queues[i].lock);
+  }
+
+  // workers drain what is left before they exit
+  for (i=0; i<FS_WB_THREADS; ++i)
+    pthread_join(queues[i].thread, NULL);
+}
+
+static void startWorkers()
+{
+  int i;
+
+  for (i=0; i<FS_WB_THREADS; ++i)
+  {
+    WbQueue* q = &queues[i];
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->ready, NULL);
+    pthread_cond_init(&q->drained, NULL);
+    q->head = q->tail = NULL;
+    q->queued   = 0;
+    q->stopping = FALSE;
+#ifdef FS_USE_IO_URING
+    q->useRing = io_uring_queue_init(FS_WB_RING_ENTRIES, &q->ring, 0) == 0;
+#endif
+    if (pthread_create(&q->thread, NULL, workerRun, q) != 0)
+    {
+      // shut down what we have, everything stays on stdio
+      int count = i;
+      for (i=0; i<count; ++i)
+      {
+        pthread_mutex_lock(&queues[i].lock);
+        queues[i].stopping = TRUE;
+        pthread_cond_signal(&queues[i].ready);
+        pthread_mutex_unlock(&queues[i].lock);
+        pthread_join(queues[i].thread, NULL);
+      }
+      return;
+    }
+  }
+
+  started = TRUE;
+  atexit(stopWorkers);
+}
+
+static bool enqueue(WriteBehind* wb, int kind, uint8_t* buf, size_t len, off_t off)
+{
+  WbQueue* q = wb->q;
+  WbReq* r = (WbReq*)malloc(sizeof(WbReq));
+
+  if (r == NULL)
+  {
+    // can't defer it, record the failure instead of losing it silently
+    free(buf);
+    if (wb->error == 0) wb->error = ENOMEM;
+    return FALSE;
+  }
+
+  r->next = NULL;
+  r->kind = kind;
+  r->wb   = wb;
+  r->buf  = buf;
+  r->len  = len;
+  r->off  = off;
+
+  __atomic_add_fetch(&wb->pending, 1, __ATOMIC_RELAXED);
+
+  pthread_mutex_lock(&q->lock);
+  // only blocks when the disk is FS_WB_MAX_QUEUED behind
+  while (q->queued > FS_WB_MAX_QUEUED)
+    pthread_cond_wait(&q->drained, &q->lock);
+  if (q->tail == NULL) q->head = r;
+  else q->tail->next = r;
+  q->tail = r;
+  q->queued += len;
+  pthread_cond_signal(&q->ready);
+  pthread_mutex_unlock(&q->lock);
+  return TRUE;
+}
+
+static void submitStage(WriteBehind* wb)
+{
+  if (wb->stageLen == 0) return;
+  enqueue(wb, WB_WRITE, wb->stage, wb->stageLen, wb->stageOff);
+  wb->stage    = NULL;
+  wb->stageLen = 0;
+}
+
+////////////////////////////////////////////////////////////////
+// Worker
+////////////////////////////////////////////////////////////////
+
+static void setError(WriteBehind* wb, int err)
+{
+  int none = 0;
+  __atomic_compare_exchange_n(&wb->error, &none, err, FALSE, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void complete(WbReq* r)
+{
+  __atomic_sub_fetch(&r->wb->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void pwriteAll(WbReq* r, size_t done)
+{
+  while (done < r->len)
+  {
+    ssize_t n = pwrite(r->wb->fd, r->buf + done, r->len - done, r->off + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0)
+    {
+      setError(r->wb, n < 0 ? errno : EIO);
+      return;
+    }
+    done += (size_t)n;
+  }
+}
+
+#ifdef FS_USE_IO_URING
+//
+// Submit the writes of a batch through the ring, a ring's worth
+// at a time.  Writes are linked so overlapping rewrites (seek back
+// to patch a header) land in order; anything short or cancelled
+// is finished with pwrite.
+//
+static void ringWrites(WbQueue* q, WbReq** reqs, int n)
+{
+  int base, i, count;
+  struct io_uring_cqe* cqe;
+
+  for (base=0; base<n; base+=FS_WB_RING_ENTRIES)
+  {
+    count = n - base;
+    if (count > FS_WB_RING_ENTRIES) count = FS_WB_RING_ENTRIES;
+
+    for (i=0; i<count; ++i)
+    {
+      WbReq* r = reqs[base+i];
+      struct io_uring_sqe* sqe = io_uring_get_sqe(&q->ring);
+      io_uring_prep_write(sqe, r->wb->fd, r->buf, (unsigned)r->len, r->off);
+      io_uring_sqe_set_data(sqe, r);
+      if (i < count-1) sqe->flags |= IOSQE_IO_LINK;
+    }
+    io_uring_submit_and_wait(&q->ring, count);
+
+    for (i=0; i<count; ++i)
+    {
+      WbReq* r;
+      if (io_uring_wait_cqe(&q->ring, &cqe) != 0) break;
+      r = (WbReq*)io_uring_cqe_get_data(cqe);
+      if (cqe->res < 0 && cqe->res != -ECANCELED && cqe->res != -EINTR)
+        setError(r->wb, -cqe->res);
+      else
+        pwriteAll(r, cqe->res > 0 ? (size_t)cqe->res : 0);
+      io_uring_cqe_seen(&q->ring, cqe);
+    }
+  }
+}
+#endif
+
+static void runBatch(WbQueue* q, WbReq* batch)
+{
+  WbReq* r;
+  WbReq* next;
+  WbReq* reqs[FS_WB_RING_ENTRIES];
+  int nreqs = 0;
+  size_t bytes = 0;
+  int synced[FS_WB_RING_ENTRIES];
+  int nsynced = 0;
+  int i;
+
+  // 1. writes, in queue order
+  for (r = batch; r != NULL; r = r->next)
+  {
+    if (r->kind != WB_WRITE) continue;
+    bytes += r->len;
+#ifdef FS_USE_IO_URING
+    if (q->useRing)
+    {
+      reqs[nreqs++] = r;
+      if (nreqs == FS_WB_RING_ENTRIES) { ringWrites(q, reqs, nreqs); nreqs = 0; }
+      continue;
+    }
+#endif
+    pwriteAll(r, 0);
+  }
+#ifdef FS_USE_IO_URING
+  if (nreqs > 0) ringWrites(q, reqs, nreqs);
+#endif
+  (void)reqs; (void)nreqs;
+
+  // 2. one fdatasync per file that asked for one in this batch
+  for (r = batch; r != NULL; r = r->next)
+  {
+    if (r->kind != WB_SYNC) continue;
+    for (i=0; i<nsynced; ++i)
+      if (synced[i] == r->wb->fd) break;
+    if (i < nsynced) continue;
+    if (fdatasync(r->wb->fd) != 0) setError(r->wb, errno);
+    if (nsynced < FS_WB_RING_ENTRIES) synced[nsynced++] = r->wb->fd;
+  }
+
+  // 3. release, closing last; fsWbClose frees wb once it sees closed
+  for (r = batch; r != NULL; r = next)
+  {
+    next = r->next;
+    if (r->kind == WB_CLOSE)
+    {
+      WriteBehind* wb = r->wb;
+      if (close(wb->fd) != 0) setError(wb, errno);
+      __atomic_store_n(&wb->closed, TRUE, __ATOMIC_RELEASE);
+    }
+    else
+    {
+      complete(r);
+    }
+    free(r->buf);
+    free(r);
+  }
+
+  pthread_mutex_lock(&q->lock);
+  q->queued -= bytes;
+  pthread_cond_broadcast(&q->drained);
+  pthread_mutex_unlock(&q->lock);
+}
+
+static void* workerRun(void* arg)
+{
+  WbQueue* q = (WbQueue*)arg;
+  WbReq* batch;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&q->lock);
+    while (q->head == NULL && !q->stopping)
+      pthread_cond_wait(&q->ready, &q->lock);
+    batch = q->head;
+    q->head = q->tail = NULL;
+    pthread_mutex_unlock(&q->lock);
+
+    if (batch == NULL) break;   // stopping and drained
+    runBatch(q, batch);
+  }
+
+#ifdef FS_USE_IO_URING
+  if (q->useRing) io_uring_queue_exit(&q->ring);
+#endif
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////
+// FileStore hooks
+////////////////////////////////////////////////////////////////
+
+bool fsWbOpen(FileHandle* h, const char* name)
+{
+  WriteBehind* wb;
+  int fd;
+
+  pthread_once(&startOnce, startWorkers);
+  if (!started) return FALSE;
+
+  if ((wb = (WriteBehind*)malloc(sizeof(WriteBehind))) == NULL) return FALSE;
+  if ((wb->name = strdup(name)) == NULL)
+  {
+    free(wb);
+    return FALSE;
+  }
+  if ((fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+  {
+    free(wb->name);
+    free(wb);
+    return FALSE;
+  }
+
+  wb->fd       = fd;
+  wb->q        = &queues[nextQueue];
+  nextQueue    = (nextQueue + 1) % FS_WB_THREADS;
+  wb->stage    = NULL;
+  wb->stageLen = 0;
+  wb->stageOff = 0;
+  wb->pos      = 0;
+  wb->pending  = 0;
+  wb->error    = 0;
+  wb->closed   = FALSE;
+  wb->nextClosing = NULL;
+
+  h->wb = wb;
+  return TRUE;
+}
+
+bool fsWbWrite(FileHandle* h, const uint8_t* buf, size_t len)
+{
+  WriteBehind* wb = h->wb;
+
+  if (__atomic_load_n(&wb->error, __ATOMIC_RELAXED) != 0) return FALSE;
+  if (len == 0) return TRUE;
+
+  // not contiguous with what is staged: ship the stage first
+  if (wb->stageLen > 0 && wb->stageOff + (off_t)wb->stageLen != wb->pos)
+    submitStage(wb);
+
+  // big writes bypass the stage but still need our own copy
+  if (len >= FS_WB_STAGE_SIZE)
+  {
+    uint8_t* copy = (uint8_t*)malloc(len);
+    if (copy == NULL) return FALSE;
+    submitStage(wb);
+    memcpy(copy, buf, len);
+    enqueue(wb, WB_WRITE, copy, len, wb->pos);
+  }
+  else
+  {
+    if (wb->stageLen + len > FS_WB_STAGE_SIZE)
+      submitStage(wb);
+    if (wb->stage == NULL)
+    {
+      if ((wb->stage = (uint8_t*)malloc(FS_WB_STAGE_SIZE)) == NULL) return FALSE;
+      wb->stageLen = 0;
+    }
+    if (wb->stageLen == 0) wb->stageOff = wb->pos;
+    memcpy(wb->stage + wb->stageLen, buf, len);
+    wb->stageLen += len;
+  }
+
+  wb->pos += (off_t)len;
+  return TRUE;
+}
+
+// like fseek, seeking past the end leaves a hole on the next write
+bool fsWbSeek(FileHandle* h, size_t pos)
+{
+  h->wb->pos = (off_t)pos;
+  return TRUE;
+}
+
+int32_t fsWbTell(FileHandle* h)
+{
+  return (int32_t)h->wb->pos;
+}
+
+void fsWbFlush(FileHandle* h)
+{
+  WriteBehind* wb = h->wb;
+
+  submitStage(wb);
+  if (fsDurability >= FS_DURABLE_FLUSH)
+    enqueue(wb, WB_SYNC, NULL, 0, 0);
+}
+
+static void freeWb(WriteBehind* wb)
+{
+  free(wb->stage);
+  free(wb->name);
+  free(wb);
+}
+
+//
+// Queues the close behind the handle's writes and returns without
+// waiting for them.  The result only covers errors seen so far; the
+// rest are reported by fsWbSettle and fsWbCloseStatus.
+//
+bool fsWbClose(FileHandle* h)
+{
+  WriteBehind* wb = h->wb;
+  WbQueue* q = wb->q;
+  bool ok;
+
+  submitStage(wb);
+  if (fsDurability >= FS_DURABLE_CLOSE)
+    enqueue(wb, WB_SYNC, NULL, 0, 0);
+
+  h->wb = NULL;
+  if (enqueue(wb, WB_CLOSE, NULL, 0, 0))
+  {
+    // the worker owns the fd now, park wb until it has closed it
+    ok = __atomic_load_n(&wb->error, __ATOMIC_RELAXED) == 0;
+    wb->nextClosing = closing;
+    closing = wb;
+    return ok;
+  }
+
+  // couldn't queue the close: wait out the writes and close here
+  pthread_mutex_lock(&q->lock);
+  while (__atomic_load_n(&wb->pending, __ATOMIC_ACQUIRE) > 0)
+    pthread_cond_wait(&q->drained, &q->lock);
+  pthread_mutex_unlock(&q->lock);
+  if (close(wb->fd) != 0) setError(wb, errno);
+
+  ok = __atomic_load_n(&wb->error, __ATOMIC_RELAXED) == 0;
+  freeWb(wb);
+  return ok;
+}
+
+//
+// Frees the closing handles of name (all if NULL) that are done,
+// waiting for them first if wait is set.  Returns the first errno
+// among the ones freed, which is also kept for fsWbCloseStatus.
+//
+static int reapClosing(const char* name, bool wait)
+{
+  WriteBehind** p = &closing;
+  WriteBehind* wb;
+  int err = 0;
+
+  while ((wb = *p) != NULL)
+  {
+    if (name != NULL && strcmp(wb->name, name) != 0) { p = &wb->nextClosing; continue; }
+
+    // the worker broadcasts drained after every batch
+    if (wait && !__atomic_load_n(&wb->closed, __ATOMIC_ACQUIRE))
+    {
+      pthread_mutex_lock(&wb->q->lock);
+      while (!__atomic_load_n(&wb->closed, __ATOMIC_ACQUIRE))
+        pthread_cond_wait(&wb->q->drained, &wb->q->lock);
+      pthread_mutex_unlock(&wb->q->lock);
+    }
+    if (!__atomic_load_n(&wb->closed, __ATOMIC_ACQUIRE)) { p = &wb->nextClosing; continue; }
+
+    *p = wb->nextClosing;
+    if (err == 0) err = wb->error;
+    freeWb(wb);
+  }
+
+  if (closeError == 0) closeError = err;
+  return err;
+}
+
+//
+// Waits until every close queued for name has run, so the file is
+// complete on disk (and synced per fsDurability).  Returns 0, or the
+// errno of a write or close of it that failed.
+//
+int fsWbSettle(const char* name)
+{
+  if (closing == NULL) return 0;
+  return reapClosing(name, TRUE);
+}
+
+//
+// Status of the closes still in the background: -errno once one of
+// them has failed (reported once), otherwise how many are left.
+//
+int32_t fsWbCloseStatus()
+{
+  WriteBehind* wb;
+  int32_t n = 0;
+  int err;
+
+  reapClosing(NULL, FALSE);
+  if ((err = closeError) != 0)
+  {
+    closeError = 0;
+    return -err;
+  }
+  for (wb = closing; wb != NULL; wb = wb->nextClosing) ++n;
+  return n;
+}
+
+int32_t fsWbStatus(FileHandle* h)
+{
+  WriteBehind* wb = h->wb;
+  int err = __atomic_load_n(&wb->error, __ATOMIC_RELAXED);
+
+  if (err != 0) return -err;
+  return __atomic_load_n(&wb->pending, __ATOMIC_ACQUIRE) + (wb->stageLen > 0 ? 1 : 0);
+}
+
+#endif
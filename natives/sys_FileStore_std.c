@@ -7,11 +7,16 @@
 //
 
 #include "../svm/sedona.h"
+#include "sys_FileStore_std.h"
 
 #include <errno.h>       // for errno, strerror
 
 #ifndef _WIN32
  #include <sys/stat.h>   // for file mode defns
+ #include <sys/mman.h>   // for mmap
+ #include <fcntl.h>
+ #include <unistd.h>
+ #define FS_USE_MMAP
 #endif
 
 // Define this to implement "scheme" convention for specifying kit/manifest DB locations
@@ -108,6 +113,265 @@ char* FSexpandFilePath( const char* ord )
 #include <windows.h>
 #endif
 
+////////////////////////////////////////////////////////////////
+// Directory Cache
+////////////////////////////////////////////////////////////////
+
+//
+// Directories we have already created (or found existing) while
+// opening files for writing, so repeated opens under the same
+// tree skip the per-component mkdir walk.  Entries are replaced
+// round robin; a failed open flushes the cache and retries.
+//
+#ifndef FS_DIR_CACHE_SIZE
+#define FS_DIR_CACHE_SIZE 32
+#endif
+
+static char* dirCache[FS_DIR_CACHE_SIZE];
+static int   dirCacheNext = 0;
+
+static bool dirCacheHas(const char* dir)
+{
+  int i;
+  for (i=0; i<FS_DIR_CACHE_SIZE; ++i)
+    if (dirCache[i] != NULL && strcmp(dirCache[i], dir) == 0) return TRUE;
+  return FALSE;
+}
+
+static void dirCacheAdd(const char* dir)
+{
+  char* copy;
+
+  if (dirCacheHas(dir)) return;
+  if ((copy = (char*)malloc(strlen(dir) + 1)) == NULL) return;
+  strcpy(copy, dir);
+
+  free(dirCache[dirCacheNext]);
+  dirCache[dirCacheNext] = copy;
+  dirCacheNext = (dirCacheNext + 1) % FS_DIR_CACHE_SIZE;
+}
+
+static void dirCacheClear()
+{
+  int i;
+  for (i=0; i<FS_DIR_CACHE_SIZE; ++i)
+  {
+    free(dirCache[i]);
+    dirCache[i] = NULL;
+  }
+}
+
+// find last path sep (either type)
+static char* lastSep(char* name)
+{
+  char* a = strrchr(name, '/');
+  char* b = strrchr(name, '\\');
+  return (a > b) ? a : b;
+}
+
+//
+// Create directories in name if they don't exist.  Name is
+// temporarily cut at each separator, same as before.
+//
+static void makeParentDirs(char* name)
+{
+  char *nxtdir, sepch, *sep, *last;
+  bool known;
+
+  // whole parent already known?
+  last = lastSep(name);
+  if (last == NULL) return;
+  sepch = *last;
+  *last = '\0';
+  known = dirCacheHas(name);
+  *last = sepch;
+  if (known) return;
+
+  // Find first path sep (either type) skipping leading sep if any
+  sep = strchr(name, '/');
+  if (sep==NULL) sep = strchr(name, '\\');
+
+  // If so, step through dir string and try to create dir(s)
+  while (sep!=NULL)
+  {
+    sepch = *sep;          // cache sep char
+    *sep = '\0';           // replace sep with null term
+
+    // create dir (should be NOP if dir exists)
+    if (!dirCacheHas(name))
+    {
+#ifdef _WIN32
+      if (mkdir((const char*)name) == 0 || errno == EEXIST)
+#else
+      if (mkdir((const char*)name, S_IRWXU | S_IRWXG | S_IRWXO) == 0 || errno == EEXIST)
+#endif
+        dirCacheAdd(name);
+    }
+
+    *sep = sepch;          // restore sep char
+    nxtdir = sep+1;        // starting point for next search
+
+    // find next path sep
+    sep = strchr(nxtdir, '/');
+    if (sep==NULL) sep = strchr(nxtdir, '\\');
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// Durability
+////////////////////////////////////////////////////////////////
+
+int fsDurability = FS_DURABLE_FLUSH;
+
+// set when write-behind files are fsync'ed, see FS_DURABLE_*
+void sys_FileStore_setDurability(int mode)
+{
+  fsDurability = mode;
+}
+
+////////////////////////////////////////////////////////////////
+// Handles
+////////////////////////////////////////////////////////////////
+
+static FileHandle* newHandle()
+{
+  FileHandle* h = (FileHandle*)malloc(sizeof(FileHandle));
+  if (h == NULL) return NULL;
+  h->fp   = NULL;
+  h->map  = NULL;
+  h->size = 0;
+  h->pos  = 0;
+  h->fd   = -1;
+  h->dev  = 0;
+  h->ino  = 0;
+  h->nextMapped = NULL;
+  h->wb   = NULL;
+  return h;
+}
+
+// handles with a mapping, so a write open can find them
+static FileHandle* mappedHandles = NULL;
+
+static void unlinkMapped(FileHandle* h)
+{
+  FileHandle** p;
+
+  for (p = &mappedHandles; *p != NULL; p = &(*p)->nextMapped)
+  {
+    if (*p == h)
+    {
+      *p = h->nextMapped;
+      h->nextMapped = NULL;
+      return;
+    }
+  }
+}
+
+//
+// Map name read-only.  Returns FALSE if the file can't be mapped
+// (empty, not a regular file, no mmap) so the caller falls back
+// to stdio.  The fd stays open for the pread fallback.
+//
+static bool mapFile(FileHandle* h, const char* name)
+{
+#ifdef FS_USE_MMAP
+  struct stat statInfo;
+  void* map;
+  int fd;
+
+  if ((fd = open(name, O_RDONLY)) < 0) return FALSE;
+  if (fstat(fd, &statInfo) != 0 || !S_ISREG(statInfo.st_mode) || statInfo.st_size <= 0)
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  map = mmap(NULL, (size_t)statInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    close(fd);
+    return FALSE;
+  }
+
+ #ifdef MADV_SEQUENTIAL
+  madvise(map, (size_t)statInfo.st_size, MADV_SEQUENTIAL);
+ #endif
+
+  h->map  = (uint8_t*)map;
+  h->size = (size_t)statInfo.st_size;
+  h->pos  = 0;
+  h->fd   = fd;
+  h->dev  = (uint64_t)statInfo.st_dev;
+  h->ino  = (uint64_t)statInfo.st_ino;
+  h->nextMapped = mappedHandles;
+  mappedHandles = h;
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+//
+// Open name for writing, through the write-behind backend for
+// plain 'w' mode where we have one, otherwise through stdio.
+//
+static bool openWrite(FileHandle* h, const char* name, char mode, const char* fopenMode)
+{
+#ifdef FS_USE_WRITE_BEHIND
+  if (mode == 'w' && fsWbOpen(h, name)) return TRUE;
+#endif
+  h->fp = fopen(name, fopenMode);
+  return h->fp != NULL;
+}
+
+static void unmapFile(FileHandle* h)
+{
+#ifdef FS_USE_MMAP
+  munmap(h->map, h->size);
+#endif
+  h->map = NULL;
+}
+
+//
+// name is about to be opened for writing, which may truncate it
+// under a mapping and fault the next access.  Mappings of the same
+// file are dropped and their handles read on with pread; views
+// handed out on them are no longer valid.
+//
+static void unmapForWrite(const char* name)
+{
+#ifdef FS_USE_MMAP
+  struct stat statInfo;
+  FileHandle* h;
+  FileHandle* next;
+
+  if (mappedHandles == NULL || stat(name, &statInfo) != 0) return;
+
+  for (h = mappedHandles; h != NULL; h = next)
+  {
+    next = h->nextMapped;
+    if (h->dev == (uint64_t)statInfo.st_dev && h->ino == (uint64_t)statInfo.st_ino)
+    {
+      unlinkMapped(h);
+      unmapFile(h);
+    }
+  }
+#endif
+}
+
+static void closeMapped(FileHandle* h)
+{
+  if (isMapped(h))
+  {
+    unlinkMapped(h);
+    unmapFile(h);
+  }
+#ifdef FS_USE_MMAP
+  close(h->fd);
+#endif
+  h->fd = -1;
+}
+
 // int FileStore.doSize(Str name)
 Cell sys_FileStore_doSize(SedonaVM* vm, Cell* params)
 {
@@ -120,6 +384,9 @@ Cell sys_FileStore_doSize(SedonaVM* vm, Cell* params)
  #endif
 
   Cell result;
+#ifdef FS_USE_WRITE_BEHIND
+  if (name != NULL) fsWbSettle(name);
+#endif
 #ifdef _WIN32
   /*
   BOOL fOk;
@@ -164,11 +431,18 @@ Cell sys_FileStore_doOpen(SedonaVM* vm, Cell* params)
   const char* mode = params[1].aval;
   const char* fopenMode;
   Cell result;
+  FileHandle* h;
   FILE* fp;
+  bool ok;
 
   // sanity check arguments
   if (name == NULL || mode == NULL) return nullCell;
 
+#ifdef FS_USE_WRITE_BEHIND
+  // a background close of this file has to land first
+  fsWbSettle(name);
+#endif
+
   // sanity check mode
   if (mode[1] != '\0') return nullCell;
   switch (mode[0])
@@ -189,47 +463,52 @@ Cell sys_FileStore_doOpen(SedonaVM* vm, Cell* params)
     default:  return nullCell;
   }
 
+  if ((h = newHandle()) == NULL) return nullCell;
+
+  //
+  // Read only files are served straight from a mapping
+  //
+  if (mode[0] == 'r' && mapFile(h, name))
+  {
+    result.aval = h;
+    return result;
+  }
 
   //
   // If opening for writing: Create directories if they don't exist
   //
   if ( (mode[0]=='m') || (mode[0]=='w') )
   {
-    char *nxtdir, sepch, *sep;
+    unmapForWrite(name);
+    makeParentDirs((char*)name);
+    ok = openWrite(h, name, mode[0], fopenMode);
 
-    // Find first path sep (either type) skipping leading sep if any
-    sep = strchr(name, '/');
-    if (sep==NULL) sep = strchr(name, '\\');
-
-    // If so, step through dir string and try to create dir(s)
-    while (sep!=NULL)
+    // a cached dir may have been removed underneath us, walk again
+    if (!ok && errno == ENOENT)
     {
-      sepch = *sep;          // cache sep char
-      *sep = '\0';           // replace sep with null term
-
-      // create dir (should be NOP if dir exists)
-#ifdef _WIN32
-      mkdir((const char*)name);
-#else
-      mkdir((const char*)name, S_IRWXU | S_IRWXG | S_IRWXO);
-#endif
-
-      *sep = sepch;          // restore sep char
-      nxtdir = sep+1;        // starting point for next search
-
-      // find next path sep
-      sep = strchr(nxtdir, '/');
-      if (sep==NULL) sep = strchr(nxtdir, '\\');
+      dirCacheClear();
+      makeParentDirs((char*)name);
+      ok = openWrite(h, name, mode[0], fopenMode);
     }
   }
-
-  result.aval = fopen(name, fopenMode);
+  else
+  {
+    h->fp = fopen(name, fopenMode);
+    ok = h->fp != NULL;
+  }
 
   // DIAG
-  if (result.aval==NULL)
+  if (!ok)
     printf("fopen('%s', '%s') failed, errno=%d (%s)\n", name, fopenMode, errno, strerror(errno));
   // DIAG
 
+  if (!ok)
+  {
+    free(h);
+    return nullCell;
+  }
+
+  result.aval = h;
   return result;
 }
 
@@ -239,11 +518,31 @@ Cell sys_FileStore_doOpen(SedonaVM* vm, Cell* params)
 // int FileStore.doRead(Obj)
 Cell sys_FileStore_doRead(SedonaVM* vm, Cell* params)
 {
-  FILE* fp  = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   Cell result;
 
   // sanity check arguments. FileStore requires -1 return value on error/eof.
-  if ((fp == NULL) || ((result.ival = fgetc(fp)) == EOF))
+  if (h == NULL) return negOneCell;
+
+  if (isMapped(h))
+  {
+    if (h->pos >= h->size) return negOneCell;
+    result.ival = h->map[h->pos++];
+    return result;
+  }
+
+#ifdef FS_USE_MMAP
+  if (isPread(h))
+  {
+    uint8_t c;
+    if (pread(h->fd, &c, 1, (off_t)h->pos) != 1) return negOneCell;
+    h->pos++;
+    result.ival = c;
+    return result;
+  }
+#endif
+
+  if ((result.ival = fgetc(h->fp)) == EOF)
 	  return negOneCell;
   else
     return result;
@@ -252,32 +551,132 @@ Cell sys_FileStore_doRead(SedonaVM* vm, Cell* params)
 // int FileStore.doReadBytes(Obj, byte[], int, int)
 Cell sys_FileStore_doReadBytes(SedonaVM* vm, Cell* params)
 {
-  FILE* fp  = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   uint8_t* buf = (uint8_t*)params[1].aval;
   int32_t  off = params[2].ival;
   int32_t  len = params[3].ival;
   Cell result;
 
   // sanity check arguments. FileStream requires -1 on eof/error.
-  if ((fp == NULL) || feof(fp) || ferror(fp)) return negOneCell;
+  if (h == NULL) return negOneCell;
 
   buf = buf + off;
 
-  result.ival = fread(buf, 1, len, fp);
+  if (isMapped(h))
+  {
+    size_t avail = h->size - h->pos;
+    if (h->pos >= h->size) return negOneCell;
+    if (len < 0) len = 0;
+    if ((size_t)len > avail) len = (int32_t)avail;
+    memcpy(buf, h->map + h->pos, len);
+    h->pos += len;
+    result.ival = len;
+    return result;
+  }
+
+#ifdef FS_USE_MMAP
+  if (isPread(h))
+  {
+    ssize_t n;
+    if (len < 0) len = 0;
+    n = pread(h->fd, buf, (size_t)len, (off_t)h->pos);
+    if (n < 0 || (n == 0 && len > 0)) return negOneCell;
+    h->pos += (size_t)n;
+    result.ival = (int32_t)n;
+    return result;
+  }
+#endif
+
+  if (feof(h->fp) || ferror(h->fp)) return negOneCell;
+
+  result.ival = fread(buf, 1, len, h->fp);
   return result;
 }
 
+// byte[] FileStore.doView(Obj)
+//
+// Zero copy access to a mapped file: returns a pointer at the
+// current read position, or null if the handle is not mapped.
+// Length is doViewLen; advance with doSeek.  The view is read-only,
+// writing to it faults.  It is valid until doClose, or until the
+// same file is opened for writing, which unmaps it.
+Cell sys_FileStore_doView(SedonaVM* vm, Cell* params)
+{
+  FileHandle* h = (FileHandle*)params[0].aval;
+  Cell result;
+
+  if (h == NULL || !isMapped(h)) return nullCell;
+
+  result.aval = h->map + h->pos;
+  return result;
+}
+
+// int FileStore.doViewLen(Obj)
+Cell sys_FileStore_doViewLen(SedonaVM* vm, Cell* params)
+{
+  FileHandle* h = (FileHandle*)params[0].aval;
+  Cell result;
+
+  if (h == NULL || !isMapped(h)) return negOneCell;
+
+  result.ival = (int32_t)(h->size - h->pos);
+  return result;
+}
+
+// int FileStore.doStatus(Obj)
+//
+// Completion status of a write-behind handle: the number of writes
+// still in flight, or -errno once one of them has failed.  Always 0
+// for handles served synchronously.  With a null handle it is the
+// status of the closes still completing in the background, where a
+// failed one is reported once.
+Cell sys_FileStore_doStatus(SedonaVM* vm, Cell* params)
+{
+  FileHandle* h = (FileHandle*)params[0].aval;
+  Cell result;
+
+  if (h == NULL)
+  {
+#ifdef FS_USE_WRITE_BEHIND
+    result.ival = fsWbCloseStatus();
+    return result;
+#else
+    return zeroCell;
+#endif
+  }
+
+#ifdef FS_USE_WRITE_BEHIND
+  if (isWriteBehind(h))
+  {
+    result.ival = fsWbStatus(h);
+    return result;
+  }
+#endif
+
+  if (h->fp != NULL && ferror(h->fp)) return negOneCell;
+  return zeroCell;
+}
+
 // bool FileStore.doWrite(Obj, int)
 Cell sys_FileStore_doWrite(SedonaVM* vm, Cell* params)
 {
-  FILE* fp  = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   int32_t b = params[1].ival;
   int32_t r;
 
   // sanity check arguments
-  if (fp == NULL ) return negOneCell;
+  if (h == NULL ) return negOneCell;
+  if (isMapped(h) || isPread(h)) return falseCell;
+
+#ifdef FS_USE_WRITE_BEHIND
+  if (isWriteBehind(h))
+  {
+    uint8_t c = (uint8_t)b;
+    return fsWbWrite(h, &c, 1) ? trueCell : falseCell;
+  }
+#endif
 
-  r = fputc(b, fp);
+  r = fputc(b, h->fp);
 
   return r == b ? trueCell : falseCell;
 }
@@ -285,18 +684,24 @@ Cell sys_FileStore_doWrite(SedonaVM* vm, Cell* params)
 // bool FileStore.doWriteBytes(Obj, byte[], int, int)
 Cell sys_FileStore_doWriteBytes(SedonaVM* vm, Cell* params)
 {
-  FILE* fp  = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   uint8_t* buf = (uint8_t*)params[1].aval;
   int32_t  off = params[2].ival;
   int32_t  len = params[3].ival;
   int32_t  r;
 
   // sanity check arguments
-  if (fp == NULL ) return negOneCell;
+  if (h == NULL ) return negOneCell;
+  if (isMapped(h) || isPread(h)) return falseCell;
 
   buf = buf + off;
 
-  r = fwrite(buf, 1, len, fp);
+#ifdef FS_USE_WRITE_BEHIND
+  if (isWriteBehind(h))
+    return (len >= 0 && fsWbWrite(h, buf, (size_t)len)) ? trueCell : falseCell;
+#endif
+
+  r = fwrite(buf, 1, len, h->fp);
 
   return r == len ? trueCell : falseCell;
 }
@@ -304,13 +709,20 @@ Cell sys_FileStore_doWriteBytes(SedonaVM* vm, Cell* params)
 // int FileStore.doTell(Obj)
 Cell sys_FileStore_doTell(SedonaVM* vm, Cell* params)
 {
-  FILE* fp = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   Cell r;
 
   // sanity check arguments
-  if (fp == NULL) return negOneCell;
+  if (h == NULL) return negOneCell;
 
-  r.ival = ftell(fp);
+  if (isMapped(h) || isPread(h))
+    r.ival = (int32_t)h->pos;
+#ifdef FS_USE_WRITE_BEHIND
+  else if (isWriteBehind(h))
+    r.ival = fsWbTell(h);
+#endif
+  else
+    r.ival = ftell(h->fp);
 
   return r;
 }
@@ -318,14 +730,33 @@ Cell sys_FileStore_doTell(SedonaVM* vm, Cell* params)
 // bool FileStore.doSeek(Obj, int)
 Cell sys_FileStore_doSeek(SedonaVM* vm, Cell* params)
 {
-  FILE* fp = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
   int32_t pos = params[1].ival;
   int32_t  r;
 
   // sanity check arguments
-  if (fp == NULL) return negOneCell;
+  if (h == NULL) return negOneCell;
+
+  if (isMapped(h))
+  {
+    if (pos < 0 || (size_t)pos > h->size) return falseCell;
+    h->pos = (size_t)pos;
+    return trueCell;
+  }
+
+  if (isPread(h))
+  {
+    if (pos < 0) return falseCell;
+    h->pos = (size_t)pos;
+    return trueCell;
+  }
+
+#ifdef FS_USE_WRITE_BEHIND
+  if (isWriteBehind(h))
+    return (pos >= 0 && fsWbSeek(h, (size_t)pos)) ? trueCell : falseCell;
+#endif
 
-  r = fseek(fp, pos, SEEK_SET);
+  r = fseek(h->fp, pos, SEEK_SET);
 
   return r == 0 ? trueCell : falseCell;
 }
@@ -333,12 +764,24 @@ Cell sys_FileStore_doSeek(SedonaVM* vm, Cell* params)
 // void FileStore.doFlush(Obj)
 Cell sys_FileStore_doFlush(SedonaVM* vm, Cell* params)
 {
-  FILE* fp = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
 
   // sanity check arguments
-  if (fp == NULL) return negOneCell;
+  if (h == NULL) return negOneCell;
+
+  if (isMapped(h) || isPread(h))
+    return nullCell;
+
+#ifdef FS_USE_WRITE_BEHIND
+  // queues the stage (and an fsync per fsDurability), never waits
+  if (isWriteBehind(h))
+  {
+    fsWbFlush(h);
+    return nullCell;
+  }
+#endif
 
-  fflush(fp);
+  fflush(h->fp);
 
   return nullCell;
 }
@@ -346,12 +789,24 @@ Cell sys_FileStore_doFlush(SedonaVM* vm, Cell* params)
 // bool FileStore.doClose(Obj)
 Cell sys_FileStore_doClose(SedonaVM* vm, Cell* params)
 {
-  FILE* fp = (FILE*)params[0].aval;
+  FileHandle* h = (FileHandle*)params[0].aval;
+  bool ok = TRUE;
 
   // sanity check arguments
-  if (fp == NULL) return negOneCell;
+  if (h == NULL) return negOneCell;
+
+  if (isMapped(h) || isPread(h))
+    closeMapped(h);
+#ifdef FS_USE_WRITE_BEHIND
+  else if (isWriteBehind(h))
+    ok = fsWbClose(h);
+#endif
+  else if (fclose(h->fp) != 0)
+    ok = FALSE;
 
-  if (fclose(fp) != 0)
+  free(h);
+
+  if (!ok)
   {
     printf("ERROR: Cannot close file\n");
     return falseCell;
@@ -375,6 +830,12 @@ Cell sys_FileStore_rename(SedonaVM* vm, Cell* params)
   int r;
   struct stat statBuf;
 
+#ifdef FS_USE_WRITE_BEHIND
+  // don't swap in a file that is still being written, or failed to be
+  if (fsWbSettle(from) != 0) return falseCell;
+  fsWbSettle(to);
+#endif
+
   if ((stat(to, &statBuf) == 0) && (remove(to) != 0))
     return falseCell;
 
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2009 Tridium, Inc.
+// Licensed under the Academic Free License version 3.0
+//
+// History:
+//   19 Oct 26  FileHandle split out for mapped reads
+//   19 Oct 26  Write-behind backend hooks
+//   19 Oct 26  Read mappings fall back to pread on a write open
+//   19 Oct 26  Write-behind closes complete in the background
+//
+
+#ifndef __SYS_FILESTORE_STD_H
+#define __SYS_FILESTORE_STD_H
+
+// includes
+#include "../svm/sedona.h"
+
+// C++
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Linux builds queue 'w' mode writes to background workers
+// (see sys_FileStore_linux.c); define FS_NO_WRITE_BEHIND to
+// keep everything on stdio.
+#if defined(__linux__) && !defined(FS_NO_WRITE_BEHIND)
+ #define FS_USE_WRITE_BEHIND
+#endif
+
+// durability points, see sys_FileStore_setDurability
+#define FS_DURABLE_NONE   0   // never fsync
+#define FS_DURABLE_CLOSE  1   // fsync before close
+#define FS_DURABLE_FLUSH  2   // fsync on every doFlush and close
+
+// current durability point, FS_DURABLE_FLUSH by default
+extern int fsDurability;
+
+struct WriteBehind;
+
+//
+// The Obj handed back to Sedona by FileStore.doOpen.  Read-only
+// files are mapped when the platform supports it and served from
+// the mapping; everything else goes through stdio.  A mapping
+// would fault once the file is truncated, so opening the same file
+// for writing unmaps it and the handle reads on with pread.
+//
+typedef struct FileHandle
+{
+  FILE*    fp;     // stdio stream, NULL when mapped
+  uint8_t* map;    // base of read-only mapping, NULL when streamed
+  size_t   size;   // mapping length
+  size_t   pos;    // read position in mapping or file
+  int      fd;     // mapped file, read with pread once unmapped, -1 if none
+  uint64_t dev;    // identity of the mapped file
+  uint64_t ino;
+  struct FileHandle*  nextMapped;  // other open mappings
+  struct WriteBehind* wb;  // write-behind state, NULL if unused
+} FileHandle;
+
+#define isMapped(h)       ((h)->map != NULL)
+#define isPread(h)        ((h)->map == NULL && (h)->fd >= 0)
+#define isWriteBehind(h)  ((h)->wb != NULL)
+
+#ifdef FS_USE_WRITE_BEHIND
+extern bool    fsWbOpen(FileHandle* h, const char* name);
+extern bool    fsWbWrite(FileHandle* h, const uint8_t* buf, size_t len);
+extern bool    fsWbSeek(FileHandle* h, size_t pos);
+extern int32_t fsWbTell(FileHandle* h);
+extern void    fsWbFlush(FileHandle* h);
+extern bool    fsWbClose(FileHandle* h);
+extern int32_t fsWbStatus(FileHandle* h);
+extern int     fsWbSettle(const char* name);
+extern int32_t fsWbCloseStatus();
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,10 +8,342 @@
 
 #include "../svm/sedona.h"
 
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#ifdef _WIN32
+  #include <io.h>
+  #include <windows.h>
+#else
+  #include <unistd.h>
+  #include <sys/uio.h>
+#endif
+
+//
+// Output is staged in a single-producer/single-consumer ring:
+// the VM thread is the only writer and a background flusher
+// thread drains it to fd 1 every flush interval.  The natives
+// never block; if the ring is full the write is dropped and
+// counted, the flusher reports the loss inline, and the native
+// still returns true.
+//
+// Draining is owned through ringOwner: the flusher and the host
+// hooks take it under drainMutex.  The crash handler waits up to
+// STDOUT_CRASH_WAIT_MS for the owner to let go, then drains with
+// raw write() calls whether it got the ring or not.
+//
+// A flush interval of 0 (see --flush=ms) bypasses the ring and
+// writes through stdio like the original implementation.
+//
+
+// must be a power of two
+#ifndef STDOUT_RING_SIZE
+#define STDOUT_RING_SIZE  (64 * 1024)
+#endif
+#define STDOUT_RING_MASK  (STDOUT_RING_SIZE - 1)
+
+#ifndef STDOUT_FLUSH_INTERVAL_MS
+#define STDOUT_FLUSH_INTERVAL_MS  20
+#endif
+
+// how long a crash waits for a drainer to release the ring
+#ifndef STDOUT_CRASH_WAIT_MS
+#define STDOUT_CRASH_WAIT_MS  100
+#endif
+
+#define STDOUT_FD  1
+
+#define FLUSHER_IDLE     0
+#define FLUSHER_RUNNING  1
+#define FLUSHER_SYNC     2
+#define FLUSHER_STOPPED  3
+
+static uint8_t  ring[STDOUT_RING_SIZE];
+static size_t   ringHead    = 0;   // advanced by VM thread only
+static size_t   ringTail    = 0;   // advanced by the ring owner
+static size_t   ringDropped = 0;
+static int      ringOwner   = 0;   // 1 while a drainer owns the tail
+
+static int      flushIntervalMs = STDOUT_FLUSH_INTERVAL_MS;
+static volatile int flusherState = FLUSHER_IDLE;
+
+static pthread_t       flusherThread;
+static pthread_mutex_t flushMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  flushCond  = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t drainMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const int crashSignals[] = { SIGSEGV, SIGILL, SIGFPE, SIGABRT, SIGTERM, SIGINT,
+#ifdef SIGBUS
+  SIGBUS,
+#endif
+};
+
+////////////////////////////////////////////////////////////////
+// Ring
+////////////////////////////////////////////////////////////////
+
+static bool ringPut(const uint8_t* buf, size_t len)
+{
+  size_t head = __atomic_load_n(&ringHead, __ATOMIC_RELAXED);
+  size_t tail = __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE);
+  size_t pos  = head & STDOUT_RING_MASK;
+  size_t first;
+
+  if (len > STDOUT_RING_SIZE - (head - tail))
+  {
+    __atomic_add_fetch(&ringDropped, len, __ATOMIC_RELAXED);
+    return FALSE;
+  }
+
+  first = STDOUT_RING_SIZE - pos;
+  if (first > len) first = len;
+  memcpy(ring + pos, buf, first);
+  memcpy(ring, buf + first, len - first);
+
+  __atomic_store_n(&ringHead, head + len, __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+// write both halves of a wrapped region, returns bytes written or -1
+static long writeSegments(const uint8_t* a, size_t alen, const uint8_t* b, size_t blen)
+{
+#ifdef _WIN32
+  long n = _write(STDOUT_FD, a, (unsigned)alen);
+  if (n == (long)alen && blen > 0)
+  {
+    long m = _write(STDOUT_FD, b, (unsigned)blen);
+    if (m > 0) n += m;
+  }
+  return n;
+#else
+  struct iovec iov[2];
+  iov[0].iov_base = (void*)a;
+  iov[0].iov_len  = alen;
+  iov[1].iov_base = (void*)b;
+  iov[1].iov_len  = blen;
+  return (long)writev(STDOUT_FD, iov, blen > 0 ? 2 : 1);
+#endif
+}
+
+// caller must own the ring, see lockedDrain
+static void ringDrain()
+{
+  size_t tail = __atomic_load_n(&ringTail, __ATOMIC_RELAXED);
+  size_t head = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE);
+  size_t dropped;
+  char msg[64];
+  int msgLen;
+
+  while (tail != head)
+  {
+    size_t pos   = tail & STDOUT_RING_MASK;
+    size_t avail = head - tail;
+    size_t first = STDOUT_RING_SIZE - pos;
+    long n;
+
+    if (first > avail) first = avail;
+    n = writeSegments(ring + pos, first, ring, avail - first);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) n = (long)avail;   // stdout is gone, discard
+
+    tail += (size_t)n;
+    __atomic_store_n(&ringTail, tail, __ATOMIC_RELEASE);
+  }
+
+  dropped = __atomic_exchange_n(&ringDropped, 0, __ATOMIC_RELAXED);
+  if (dropped > 0)
+  {
+    msgLen = sprintf(msg, "\n[stdout: %lu bytes dropped]\n", (unsigned long)dropped);
+    writeSegments((const uint8_t*)msg, (size_t)msgLen, NULL, 0);
+  }
+}
+
+static void lockedDrain()
+{
+  int idle = 0;
+
+  pthread_mutex_lock(&drainMutex);
+  if (__atomic_compare_exchange_n(&ringOwner, &idle, 1, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+  {
+    ringDrain();
+    __atomic_store_n(&ringOwner, 0, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&drainMutex);
+}
+
+// signal handler drain, async-signal-safe: raw write() only
+static void crashDrain()
+{
+  static const char lost[] = "\n[stdout: bytes dropped]\n";
+  size_t tail = __atomic_load_n(&ringTail, __ATOMIC_RELAXED);
+  size_t head = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE);
+
+  while (tail != head)
+  {
+    size_t pos   = tail & STDOUT_RING_MASK;
+    size_t first = STDOUT_RING_SIZE - pos;
+    long n;
+
+    if (first > head - tail) first = head - tail;
+#ifdef _WIN32
+    n = _write(STDOUT_FD, ring + pos, (unsigned)first);
+#else
+    n = (long)write(STDOUT_FD, ring + pos, first);
+#endif
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    tail += (size_t)n;
+  }
+  __atomic_store_n(&ringTail, tail, __ATOMIC_RELEASE);
+
+  if (__atomic_load_n(&ringDropped, __ATOMIC_RELAXED) > 0)
+  {
+#ifdef _WIN32
+    _write(STDOUT_FD, lost, sizeof(lost) - 1);
+#else
+    write(STDOUT_FD, lost, sizeof(lost) - 1);
+#endif
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// Flusher
+////////////////////////////////////////////////////////////////
+
+static void* flusherRun(void* arg)
+{
+  struct timespec ts;
+
+  pthread_mutex_lock(&flushMutex);
+  while (flusherState == FLUSHER_RUNNING)
+  {
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec  += flushIntervalMs / 1000;
+    ts.tv_nsec += (long)(flushIntervalMs % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+      ts.tv_sec++;
+      ts.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&flushCond, &flushMutex, &ts);
+    pthread_mutex_unlock(&flushMutex);
+
+    // keep anything printf'ed by the VM itself ahead of us
+    fflush(stdout);
+    lockedDrain();
+
+    pthread_mutex_lock(&flushMutex);
+  }
+  pthread_mutex_unlock(&flushMutex);
+  return NULL;
+}
+
+static void onCrash(int sig)
+{
+#ifndef _WIN32
+  struct timespec tick = { 0, 1000000L };
+#endif
+  int idle = 0;
+  int waited;
+
+  // a drainer on another thread finishes its write and lets go; if
+  // it is the thread we interrupted it never will, so drain anyway.
+  // Its tail is published after every write, so at worst the write
+  // it was in the middle of comes out twice.
+  for (waited = 0; waited < STDOUT_CRASH_WAIT_MS; ++waited)
+  {
+    if (__atomic_compare_exchange_n(&ringOwner, &idle, 1, FALSE, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      break;
+    idle = 0;
+#ifdef _WIN32
+    Sleep(1);
+#else
+    nanosleep(&tick, NULL);
+#endif
+  }
+  crashDrain();
+
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+static void onExit()
+{
+  if (flusherState == FLUSHER_RUNNING)
+  {
+    pthread_mutex_lock(&flushMutex);
+    flusherState = FLUSHER_STOPPED;
+    pthread_cond_signal(&flushCond);
+    pthread_mutex_unlock(&flushMutex);
+    pthread_join(flusherThread, NULL);
+  }
+
+  fflush(stdout);
+  lockedDrain();
+}
+
+static void startFlusher()
+{
+  size_t i;
+
+  if (flushIntervalMs <= 0)
+  {
+    flusherState = FLUSHER_SYNC;
+    return;
+  }
+
+  flusherState = FLUSHER_RUNNING;
+  if (pthread_create(&flusherThread, NULL, flusherRun, NULL) != 0)
+  {
+    flusherState = FLUSHER_SYNC;
+    return;
+  }
+
+  atexit(onExit);
+  for (i=0; i<sizeof(crashSignals)/sizeof(crashSignals[0]); ++i)
+    signal(crashSignals[i], onCrash);
+}
+
+#define ensureFlusher() \
+  if (flusherState == FLUSHER_IDLE) startFlusher()
+
+////////////////////////////////////////////////////////////////
+// Host Hooks
+////////////////////////////////////////////////////////////////
+
+// set the flush interval in ms; must be called before the first write
+void sys_StdOutStream_setFlushInterval(int ms)
+{
+  flushIntervalMs = ms;
+}
+
+// synchronously drain pending output, used by the host before
+// it prints on its own (assert failures, VM exit summary)
+void sys_StdOutStream_sync()
+{
+  if (flusherState != FLUSHER_RUNNING) return;
+
+  lockedDrain();
+}
+
+////////////////////////////////////////////////////////////////
+// Natives
+////////////////////////////////////////////////////////////////
+
 // bool StdOutStream.doWrite(int)
 Cell sys_StdOutStream_doWrite(SedonaVM* vm, Cell* params)
 {
   int32_t b = params[0].ival;
+  uint8_t c = (uint8_t)b;
+
+  ensureFlusher();
+  if (flusherState == FLUSHER_RUNNING)
+  {
+    ringPut(&c, 1);   // overflow is counted and reported by the flusher
+    return trueCell;
+  }
 
   putchar(b);
   if (b == (int32_t)'\n')
@@ -29,6 +361,15 @@ Cell sys_StdOutStream_doWriteBytes(SedonaVM* vm, Cell* params)
 
   buf = buf + off;
 
+  if (len <= 0) return trueCell;
+
+  ensureFlusher();
+  if (flusherState == FLUSHER_RUNNING)
+  {
+    ringPut(buf, (size_t)len);
+    return trueCell;
+  }
+
   fwrite(buf, 1, len, stdout);
 
   return trueCell;
@@ -37,9 +378,10 @@ Cell sys_StdOutStream_doWriteBytes(SedonaVM* vm, Cell* params)
 // void StdOutStream.doFlush()
 Cell sys_StdOutStream_doFlush(SedonaVM* vm, Cell* params)
 {
-  fflush(stdout);
+  // never block the VM thread, just wake the flusher early
+  if (flusherState == FLUSHER_RUNNING)
+    pthread_cond_signal(&flushCond);
+  else
+    fflush(stdout);
   return nullCell;
 }
-
-
-
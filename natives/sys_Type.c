@@ -4,6 +4,7 @@
 //
 // History:
 //   22 May 07  Brian Frank  Creation
+//   19 Oct 26  Run initializer with vmCallInline
 //
 
 #include "../svm/sedona.h"
@@ -23,9 +24,11 @@ Cell sys_Type_malloc(SedonaVM* vm, Cell* params)
   if (mem == NULL) return nullCell;
   memset(mem, 0, size);
 
-  // call instance initializer method
+  // call instance initializer method; when queued inline it runs
+  // right after we return, with our result already on the stack
   args[0].aval = mem;
-  vm->call(vm, init, args, 1);
+  if (!vmCallInline(vm, init, args, 1))
+    vm->call(vm, init, args, 1);
 
   // return instance pointer
   ret.aval = mem;
@@ -4,6 +4,7 @@
 //
 // History:
 //   4 Mar 07  Brian Frank  Creation
+//   19 Oct 26  vmCallInline
 //
 
 #ifndef __SEDONA_H
@@ -355,6 +356,11 @@ typedef Cell (*NativeMethod)(struct SedonaVM_s* vm, Cell* params);
 typedef int64_t (*NativeMethodWide)(struct SedonaVM_s* vm, Cell* params);
 
 
+// max words a native can pass to vmCallInline
+#ifndef VM_INLINE_MAX_ARGS
+#define VM_INLINE_MAX_ARGS 4
+#endif
+
 // SedonaVM
 typedef struct SedonaVM_s
 {
@@ -384,6 +390,9 @@ typedef struct SedonaVM_s
 
   // private fields
   uint8_t*  dataBaseAddr;     // base for static field data
+  uint16_t  inlineMethod;     // call queued by vmCallInline, or 0
+  uint8_t   inlineArgc;       // num of words in inlineArgs
+  Cell      inlineArgs[VM_INLINE_MAX_ARGS];
 }
 SedonaVM;
 
@@ -391,11 +400,11 @@ SedonaVM;
 // Virtual Machine Control
 extern int vmRun(SedonaVM* vm);
 extern int vmResume(SedonaVM* vm);
+extern int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc);
 #ifdef SCODE_DEBUG
     extern int vmCallDebug(SedonaVM* vm, uint16_t method, Cell* args, int argc);
-#else
-    extern int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc);
 #endif // SCODE_DEBUG
+extern bool vmCallInline(SedonaVM* vm, uint16_t method, Cell* args, int argc);
 
 // Virtual Machine Debug
 #ifdef SCODE_DEBUG
@@ -4,6 +4,16 @@
 //
 // History:
 //   4 Mar 07  Brian Frank  Creation
+//   19 Oct 26  vmCallInline
+//   19 Oct 26  Resolve native table at init
+//   19 Oct 26  Breakpoints by opcode patching
+//   19 Oct 26  Hot switch to the debug loop at calls
+//   19 Oct 26  Safepoints
+//   19 Oct 26  Condition variable suspend
+//   19 Oct 26  Computed goto in debug builds
+//   19 Oct 26  Missing natives fail the call, not the process
+//   19 Oct 26  Breakpoint side table grows
+//   19 Oct 26  Bounded safepoint waits
 //
 
 #include "../svm/sedona.h"
@@ -22,6 +32,16 @@
   #define Case case
 #endif
 
+// in VM_DEBUG_MODE calls, returns and backward jumps are safepoints
+// where queued debugger tasks run, see runSafepoint
+#ifdef VM_DEBUG_MODE
+  #define Safepoint()  do { if (safepointWord) runSafepoint(); } while (0)
+  #define Branch(off)  (s8 = (off), cp += s8, (s8 < 0 && safepointWord) ? runSafepoint() : (void)0)
+#else
+  #define Safepoint()  do { } while (0)
+  #define Branch(off)  (cp += (off))
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 // Globals
 //////////////////////////////////////////////////////////////////////////
@@ -31,16 +51,22 @@ Cell negOneCell;
 //////////////////////////////////////////////////////////////////////////
 // External Forwards
 //////////////////////////////////////////////////////////////////////////
-#ifdef SCODE_DEBUG
-    extern int isNativeIdValid(int kitId, int methodId);
-#endif
+extern int isNativeIdValid(int kitId, int methodId);
 
 #ifdef VM_DEBUG_MODE
 
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include "../jdwp/initializer.h"
 #include "../jdwp/misc/MConstants.h"
 
-#define VM_WAIT_ONHOLD 1
+
+// debugger trap patched over an opcode at runtime; never in scode image
+#define Breakpoint     255
+#define PATCH_CHUNK    256   // breakpoint side table grows by this many entries
+#define SAFEPOINT_TASKS 16   // power of 2
+#define SAFEPOINT_TIMEOUT_S 1 // a VM thread in a long native gives up the task after this
 const static threadid_t APP_TID       = 1;
 static volatile u1 isVMSuspended      = FALSE;
 static volatile u1 isSingleStep       = FALSE;
@@ -67,6 +93,25 @@ static void force_earlyExitMethod();
 static void vmExit();
 static u1 suspendCount();
 static FrameContainer** getAllFrames();
+static u1 setBreakpoint(Location* loc);
+static void clearBreakpoint(Location* loc);
+static uint8_t onBreakpoint(uint8_t* cp);
+static void waitWhileSuspended();
+static void runSafepoint();
+static u1 atSafepoint(void (*task)(void));
+static void setVmStarted(u1 started);
+static void wakeVM();
+
+// the VM thread parks on vmWake while suspended, see waitWhileSuspended
+static pthread_mutex_t vmWakeMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  vmWake      = PTHREAD_COND_INITIALIZER;
+
+// nonzero while tasks are queued for the next safepoint
+static volatile uint32_t safepointWord = 0;
+
+// vmCall switches calls into debugLoop while *debugActive or suspended
+static volatile u1 debugInactive = FALSE;
+static volatile u1* debugActive  = &debugInactive;
 
 #ifdef __WIN32
 inline static void sleep(unsigned long s) {
@@ -89,6 +134,11 @@ void init_vmController() {
   VMController->resume = onVM_Resume;
   VMController->exit = vmExit;
   VMController->getAllFrames = getAllFrames;
+  VMController->set_breakpoint = setBreakpoint;
+  VMController->clear_breakpoint = clearBreakpoint;
+  VMController->at_safepoint = atSafepoint;
+  VMController->wake = wakeVM;
+  debugActive = EventHandler->active;
   onVM_Suspend();
 
   frames = (FrameContainer**) malloc(sizeof(FrameContainer) * framesAllocated);
@@ -163,7 +213,7 @@ inline static threadid_t getAppTID() {
 }
 
 inline static u1 getCurrByteCode() {
-  return InitArray; // place holder
+  return 230; // InitArray, place holder
 }
 
 inline static size_t getFrames() {
@@ -192,9 +242,618 @@ inline static u1 onVM_Exit(){
 
 // onVM Resume
 inline static void onVM_Resume(){
-    if(suspendCount != 0) {
+    if(suspendCounter != 0) {
         suspendCounter--;
     }
+    wakeVM();
+}
+
+// signal a state change to a parked VM thread; the change must be
+// visible before the call so the waiter cannot miss it
+inline static void wakeVM() {
+    pthread_mutex_lock(&vmWakeMutex);
+    pthread_cond_broadcast(&vmWake);
+    pthread_mutex_unlock(&vmWakeMutex);
+}
+
+// park the VM thread while the debugger holds it suspended, woken
+// by resume, ReleaseEvents and queued safepoint tasks
+inline static void waitWhileSuspended() {
+    while(isVM_Suspended() == TRUE) {
+        pthread_mutex_lock(&vmWakeMutex);
+        while(isVM_Suspended() == TRUE &&
+              EventHandler->canDispatchAll() == FALSE &&
+              safepointWord == 0) {
+            pthread_cond_wait(&vmWake, &vmWakeMutex);
+        }
+        pthread_mutex_unlock(&vmWakeMutex);
+
+        Safepoint();
+        if(isVM_Suspended() == FALSE || EventHandler->canDispatchAll() == FALSE) {
+            continue;
+        }
+
+        EventHandler->dispatchAll(); // should be only queued waiters
+        onVM_Resume();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Breakpoints
+//////////////////////////////////////////////////////////////////////////
+
+//
+// A breakpoint overwrites the opcode at its location with the
+// Breakpoint trap, so code without breakpoints runs unchecked.  The
+// original opcode is kept in a side table; entries are never removed
+// or moved, only their reference count drops to zero, so the VM thread
+// can look up an address it trapped on without a lock even if the
+// debugger restored the opcode in between.  The table is a list of
+// chunks that grows as new locations are patched; a location that is
+// set again reuses its entry, so it is bounded by the code size.
+// set/clear are serialized by the event dispatcher's lock.  A location names a registry method; only
+// methods bound to an scode block can be patched, and only at the
+// start of an instruction.
+//
+typedef struct {
+  uint8_t*   addr;    // patched opcode address
+  uint8_t    opcode;  // original opcode
+  uint16_t   refs;    // requests at this location
+  methodid_t mid;     // registry location reported on a trap
+  u8         index;
+} PatchedOpcode;
+
+typedef struct PatchChunk {
+  PatchedOpcode      entries[PATCH_CHUNK];
+  struct PatchChunk* next;
+} PatchChunk;
+
+static PatchChunk  patches;
+static PatchChunk* lastPatches = &patches;
+static volatile int patchCount = 0;   // published after the entry (and chunk) is set
+static uint8_t* debugCodeBase  = NULL;
+static size_t   debugCodeSize  = 0;
+
+inline static PatchedOpcode* findPatch(uint8_t* addr) {
+  int n = __atomic_load_n(&patchCount, __ATOMIC_ACQUIRE);
+  PatchChunk* c;
+  int i;
+
+  for (c = &patches; n > 0; c = c->next, n -= PATCH_CHUNK)
+    for (i=0; i<n && i<PATCH_CHUNK; ++i)
+      if (c->entries[i].addr == addr) return &c->entries[i];
+  return NULL;
+}
+
+// original opcode under a trap at cp, Nop (0) if the trap is not ours
+inline static uint8_t patchedOpcode(uint8_t* cp) {
+  PatchedOpcode* p = findPatch(cp);
+
+  return p != NULL ? p->opcode : 0;
+}
+
+// the registry's main method runs the image's main block, see vmEntry
+inline static void bindMainMethod(SedonaVM* vm) {
+  RefTypeID* mainClass = RefHandler->getStartRef();
+  u2 i;
+
+  if (mainClass == NULL) return;
+  for (i=0; i<mainClass->num_methods; ++i)
+    if (strcmp((char*)mainClass->methods[i]->methodName, "main") == 0)
+      mainClass->methods[i]->block = *(uint16_t*)(vm->codeBaseAddr+16);
+}
+
+// scode block of the registry method at loc, 0 if it has none
+inline static uint16_t methodBlock(Location* loc) {
+  method* m = RefHandler->get_method((referencetypeid_t)loc->classID, loc->methodID);
+
+  if (m == NULL || m->block == 0) return 0;
+  if ((size_t)m->block * SCODE_BLOCK_SIZE + 2 >= debugCodeSize) return 0;
+  return m->block;
+}
+
+//
+// Per opcode, indexed like OpcodePointerOffsets in scode.h: the
+// instruction length including the opcode (0 for opcodes the VM does
+// not accept; Switch adds its jump table) and how it transfers
+// control.  Positional, so it does not need the opcode constants
+// that computed goto builds turn into labels.
+//
+#define OP_NEAR    0x10   // s1 branch offset at cp+1
+#define OP_FAR     0x20   // s2 branch offset at cp+1
+#define OP_SWITCH  0x30   // u2 count at cp+1, then count s2 offsets
+#define OP_RETURN  0x40
+#define opLength(info)  ((info) & 0x0f)
+#define opKind(info)    ((info) & 0xf0)
+
+static const uint8_t OpcodeInfo[] =
+{
+  1,              // 0 Nop
+  1,              // 1 LoadIM1
+  1,              // 2 LoadI0
+  1,              // 3 LoadI1
+  1,              // 4 LoadI2
+  1,              // 5 LoadI3
+  1,              // 6 LoadI4
+  1,              // 7 LoadI5
+  2,              // 8 LoadIntU1
+  3,              // 9 LoadIntU2
+  1,              // 10 LoadL0
+  1,              // 11 LoadL1
+  1,              // 12 LoadF0
+  1,              // 13 LoadF1
+  1,              // 14 LoadD0
+  1,              // 15 LoadD1
+  1,              // 16 LoadNull
+  1,              // 17 LoadNullBool
+  1,              // 18 LoadNullFloat
+  1,              // 19 LoadNullDouble
+  3,              // 20 LoadInt
+  3,              // 21 LoadFloat
+  3,              // 22 LoadLong
+  3,              // 23 LoadDouble
+  3,              // 24 LoadStr
+  3,              // 25 LoadBuf
+  3,              // 26 LoadType
+  3,              // 27 LoadSlot
+  0,              // 28 LoadDefine
+  1,              // 29 LoadParam0
+  1,              // 30 LoadParam1
+  1,              // 31 LoadParam2
+  1,              // 32 LoadParam3
+  2,              // 33 LoadParam
+  2,              // 34 LoadParamWide
+  2,              // 35 StoreParam
+  2,              // 36 StoreParamWide
+  1,              // 37 LoadLocal0
+  1,              // 38 LoadLocal1
+  1,              // 39 LoadLocal2
+  1,              // 40 LoadLocal3
+  1,              // 41 LoadLocal4
+  1,              // 42 LoadLocal5
+  1,              // 43 LoadLocal6
+  1,              // 44 LoadLocal7
+  2,              // 45 LoadLocal
+  2,              // 46 LoadLocalWide
+  1,              // 47 StoreLocal0
+  1,              // 48 StoreLocal1
+  1,              // 49 StoreLocal2
+  1,              // 50 StoreLocal3
+  1,              // 51 StoreLocal4
+  1,              // 52 StoreLocal5
+  1,              // 53 StoreLocal6
+  1,              // 54 StoreLocal7
+  2,              // 55 StoreLocal
+  2,              // 56 StoreLocalWide
+  1,              // 57 IntEq
+  1,              // 58 IntNotEq
+  1,              // 59 IntGt
+  1,              // 60 IntGtEq
+  1,              // 61 IntLt
+  1,              // 62 IntLtEq
+  1,              // 63 IntMul
+  1,              // 64 IntDiv
+  1,              // 65 IntMod
+  1,              // 66 IntAdd
+  1,              // 67 IntSub
+  1,              // 68 IntOr
+  1,              // 69 IntXor
+  1,              // 70 IntAnd
+  1,              // 71 IntNot
+  1,              // 72 IntNeg
+  1,              // 73 IntShiftL
+  1,              // 74 IntShiftR
+  1,              // 75 IntInc
+  1,              // 76 IntDec
+  1,              // 77 LongEq
+  1,              // 78 LongNotEq
+  1,              // 79 LongGt
+  1,              // 80 LongGtEq
+  1,              // 81 LongLt
+  1,              // 82 LongLtEq
+  1,              // 83 LongMul
+  1,              // 84 LongDiv
+  1,              // 85 LongMod
+  1,              // 86 LongAdd
+  1,              // 87 LongSub
+  1,              // 88 LongOr
+  1,              // 89 LongXor
+  1,              // 90 LongAnd
+  1,              // 91 LongNot
+  1,              // 92 LongNeg
+  1,              // 93 LongShiftL
+  1,              // 94 LongShiftR
+  1,              // 95 FloatEq
+  1,              // 96 FloatNotEq
+  1,              // 97 FloatGt
+  1,              // 98 FloatGtEq
+  1,              // 99 FloatLt
+  1,              // 100 FloatLtEq
+  1,              // 101 FloatMul
+  1,              // 102 FloatDiv
+  1,              // 103 FloatAdd
+  1,              // 104 FloatSub
+  1,              // 105 FloatNeg
+  1,              // 106 DoubleEq
+  1,              // 107 DoubleNotEq
+  1,              // 108 DoubleGt
+  1,              // 109 DoubleGtEq
+  1,              // 110 DoubleLt
+  1,              // 111 DoubleLtEq
+  1,              // 112 DoubleMul
+  1,              // 113 DoubleDiv
+  1,              // 114 DoubleAdd
+  1,              // 115 DoubleSub
+  1,              // 116 DoubleNeg
+  1,              // 117 IntToFloat
+  1,              // 118 IntToLong
+  1,              // 119 IntToDouble
+  1,              // 120 LongToInt
+  1,              // 121 LongToFloat
+  1,              // 122 LongToDouble
+  1,              // 123 FloatToInt
+  1,              // 124 FloatToLong
+  1,              // 125 FloatToDouble
+  1,              // 126 DoubleToInt
+  1,              // 127 DoubleToLong
+  1,              // 128 DoubleToFloat
+  1,              // 129 ObjEq
+  1,              // 130 ObjNotEq
+  1,              // 131 EqZero
+  1,              // 132 NotEqZero
+  1,              // 133 Pop
+  1,              // 134 Pop2
+  1,              // 135 Pop3
+  1,              // 136 Dup
+  1,              // 137 Dup2
+  1,              // 138 DupDown2
+  1,              // 139 DupDown3
+  1,              // 140 Dup2Down2
+  1,              // 141 Dup2Down3
+  OP_NEAR | 2,    // 142 Jump
+  OP_NEAR | 2,    // 143 JumpNonZero
+  OP_NEAR | 2,    // 144 JumpZero
+  OP_NEAR | 2,    // 145 Foreach
+  OP_FAR | 3,     // 146 JumpFar
+  OP_FAR | 3,     // 147 JumpFarNonZero
+  OP_FAR | 3,     // 148 JumpFarZero
+  OP_FAR | 3,     // 149 ForeachFar
+  OP_NEAR | 2,    // 150 JumpIntEq
+  OP_NEAR | 2,    // 151 JumpIntNotEq
+  OP_NEAR | 2,    // 152 JumpIntGt
+  OP_NEAR | 2,    // 153 JumpIntGtEq
+  OP_NEAR | 2,    // 154 JumpIntLt
+  OP_NEAR | 2,    // 155 JumpIntLtEq
+  OP_FAR | 3,     // 156 JumpFarIntEq
+  OP_FAR | 3,     // 157 JumpFarIntNotEq
+  OP_FAR | 3,     // 158 JumpFarIntGt
+  OP_FAR | 3,     // 159 JumpFarIntGtEq
+  OP_FAR | 3,     // 160 JumpFarIntLt
+  OP_FAR | 3,     // 161 JumpFarIntLtEq
+  1,              // 162 LoadDataAddr
+  2,              // 163 Load8BitFieldU1
+  3,              // 164 Load8BitFieldU2
+  5,              // 165 Load8BitFieldU4
+  1,              // 166 Load8BitArray
+  2,              // 167 Store8BitFieldU1
+  3,              // 168 Store8BitFieldU2
+  5,              // 169 Store8BitFieldU4
+  1,              // 170 Store8BitArray
+  1,              // 171 Add8BitArray
+  2,              // 172 Load16BitFieldU1
+  3,              // 173 Load16BitFieldU2
+  5,              // 174 Load16BitFieldU4
+  1,              // 175 Load16BitArray
+  2,              // 176 Store16BitFieldU1
+  3,              // 177 Store16BitFieldU2
+  5,              // 178 Store16BitFieldU4
+  1,              // 179 Store16BitArray
+  1,              // 180 Add16BitArray
+  2,              // 181 Load32BitFieldU1
+  3,              // 182 Load32BitFieldU2
+  5,              // 183 Load32BitFieldU4
+  1,              // 184 Load32BitArray
+  2,              // 185 Store32BitFieldU1
+  3,              // 186 Store32BitFieldU2
+  5,              // 187 Store32BitFieldU4
+  1,              // 188 Store32BitArray
+  1,              // 189 Add32BitArray
+  2,              // 190 Load64BitFieldU1
+  3,              // 191 Load64BitFieldU2
+  5,              // 192 Load64BitFieldU4
+  1,              // 193 Load64BitArray
+  2,              // 194 Store64BitFieldU1
+  3,              // 195 Store64BitFieldU2
+  5,              // 196 Store64BitFieldU4
+  1,              // 197 Store64BitArray
+  1,              // 198 Add64BitArray
+  2,              // 199 LoadRefFieldU1
+  3,              // 200 LoadRefFieldU2
+  5,              // 201 LoadRefFieldU4
+  1,              // 202 LoadRefArray
+  2,              // 203 StoreRefFieldU1
+  3,              // 204 StoreRefFieldU2
+  5,              // 205 StoreRefFieldU4
+  1,              // 206 StoreRefArray
+  1,              // 207 AddRefArray
+  2,              // 208 LoadConstFieldU1
+  3,              // 209 LoadConstFieldU2
+  3,              // 210 LoadConstStatic
+  1,              // 211 LoadConstArray
+  2,              // 212 LoadInlineFieldU1
+  3,              // 213 LoadInlineFieldU2
+  5,              // 214 LoadInlineFieldU4
+  2,              // 215 LoadParam0InlineFieldU1
+  3,              // 216 LoadParam0InlineFieldU2
+  5,              // 217 LoadParam0InlineFieldU4
+  2,              // 218 LoadDataInlineFieldU1
+  3,              // 219 LoadDataInlineFieldU2
+  5,              // 220 LoadDataInlineFieldU4
+  3,              // 221 Call
+  4,              // 222 CallVirtual
+  4,              // 223 CallNative
+  4,              // 224 CallNativeWide
+  4,              // 225 CallNativeVoid
+  OP_RETURN | 1,  // 226 ReturnVoid
+  OP_RETURN | 1,  // 227 ReturnPop
+  OP_RETURN | 1,  // 228 ReturnPopWide
+  3,              // 229 LoadParam0Call
+  1,              // 230 InitArray
+  3,              // 231 InitVirt
+  3,              // 232 InitComp
+  0,              // 233 SizeOf
+  3,              // 234 Assert
+  OP_SWITCH | 3,  // 235 Switch
+  3,              // 236 MetaSlot
+  0,              // 237 Cast
+  0,              // 238 LoadArrayLiteral
+  0,              // 239 LoadSlotId
+};
+
+#define NUM_DEBUG_OPCODES  (sizeof(OpcodeInfo) / sizeof(OpcodeInfo[0]))
+
+// length of the instruction at cp, 0 if it can't be decoded
+static int opcodeLength(uint8_t op, uint8_t* cp) {
+  if (op >= NUM_DEBUG_OPCODES) return 0;
+  if (opKind(OpcodeInfo[op]) == OP_SWITCH)
+    return 3 + *(uint16_t*)(cp+1) * 2;
+  return opLength(OpcodeInfo[op]);
+}
+
+// furthest forward branch target of the instruction at cp
+static uint8_t* branchReach(uint8_t op, uint8_t* cp, int len) {
+  uint8_t* reach = cp;
+  uint16_t i, n;
+
+  switch (opKind(OpcodeInfo[op]))
+  {
+    case OP_NEAR:
+      reach = cp + *(int8_t*)(cp+1);
+      break;
+    case OP_FAR:
+      reach = cp + *(int16_t*)(cp+1);
+      break;
+    case OP_SWITCH:
+      reach = cp + len;
+      n = *(uint16_t*)(cp+1);
+      for (i=0; i<n; ++i)
+        if (cp + *(int16_t*)(cp+3+i*2) > reach) reach = cp + *(int16_t*)(cp+3+i*2);
+      break;
+  }
+  return reach;
+}
+
+// decode the method at block from its first opcode: TRUE if index is
+// the start of one of its instructions.  Jumps may skip past a return,
+// the method ends at the first return no jump reaches beyond.
+static u1 isInstruction(uint16_t block, u8 index) {
+  uint8_t* cp     = (uint8_t*)block2addr(debugCodeBase, block) + 2;
+  uint8_t* target = cp + index;
+  uint8_t* end    = debugCodeBase + debugCodeSize;
+  uint8_t* reach  = cp;
+  uint8_t* to;
+  PatchedOpcode* p;
+  uint8_t op;
+  int len;
+
+  if (index >= debugCodeSize) return FALSE;
+
+  while (cp <= target && cp < end)
+  {
+    op = *cp;
+    if (op == Breakpoint)
+    {
+      if ((p = findPatch(cp)) == NULL) return FALSE;
+      op = p->opcode;
+    }
+    if (cp == target) return TRUE;
+
+    if (op < NUM_DEBUG_OPCODES && opKind(OpcodeInfo[op]) == OP_SWITCH && cp + 3 > end) return FALSE;
+    len = opcodeLength(op, cp);
+    if (len == 0 || cp + len > end) return FALSE;
+
+    to = branchReach(op, cp, len);
+    if (to > reach) reach = to;
+    if (opKind(OpcodeInfo[op]) == OP_RETURN && cp >= reach) return FALSE;
+    cp += len;
+  }
+  return FALSE;
+}
+
+// location must be an instruction of a registry method with scode
+inline static u1 setBreakpoint(Location* loc) {
+  uint16_t block;
+  uint8_t* addr;
+  PatchedOpcode* p;
+
+  if (debugCodeBase == NULL || (block = methodBlock(loc)) == 0) return FALSE;
+  if (!isInstruction(block, loc->index)) return FALSE;
+  addr = (uint8_t*)block2addr(debugCodeBase, block) + 2 + loc->index;
+
+  p = findPatch(addr);
+  if (p == NULL) {
+    if (patchCount > 0 && patchCount % PATCH_CHUNK == 0) {
+      PatchChunk* c = (PatchChunk*)calloc(1, sizeof(PatchChunk));
+      if (c == NULL) return FALSE;
+      lastPatches->next = c;
+      lastPatches = c;
+    }
+    p = &lastPatches->entries[patchCount % PATCH_CHUNK];
+    p->addr   = addr;
+    p->opcode = *addr;
+    p->refs   = 0;
+    p->mid    = loc->methodID;
+    p->index  = loc->index;
+    __atomic_store_n(&patchCount, patchCount + 1, __ATOMIC_RELEASE);
+  }
+
+  if (p->refs++ == 0)
+    __atomic_store_n(addr, Breakpoint, __ATOMIC_RELEASE);
+  return TRUE;
+}
+
+inline static void clearBreakpoint(Location* loc) {
+  uint16_t block;
+  PatchedOpcode* p;
+
+  if (debugCodeBase == NULL || (block = methodBlock(loc)) == 0) return;
+  p = findPatch((uint8_t*)block2addr(debugCodeBase, block) + 2 + loc->index);
+
+  if (p == NULL || p->refs == 0) return;
+  if (--p->refs == 0)
+    __atomic_store_n(p->addr, p->opcode, __ATOMIC_RELEASE);
+}
+
+// VM thread trapped at cp: report the location and return the
+// original opcode to execute in place of the trap
+inline static uint8_t onBreakpoint(uint8_t* cp) {
+  PatchedOpcode* p = findPatch(cp);
+
+  if (p == NULL) return Breakpoint;  // not ours, fails as unknown opcode
+
+  if (p->refs > 0)
+    EventHandler->breakpoint(p->mid, p->index);
+  return p->opcode;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Safepoints
+//////////////////////////////////////////////////////////////////////////
+
+//
+// The JDWP thread must not read frames or the stack while the VM
+// thread changes them.  Commands that read VM state are queued with
+// atSafepoint on a single producer/single consumer ring and run by
+// the VM thread the next time it polls safepointWord: at calls,
+// returns and backward jumps, and while parked suspended.  The JDWP
+// thread blocks until its task has run, so the command parser state
+// it shares with the task is not touched meanwhile.  A VM thread busy
+// in a native may not poll for a long time, so the wait is bounded:
+// the JDWP thread then takes its task back out of its slot (the VM
+// thread skips empty slots) unless the VM thread already claimed it.
+// While no scode runs (before vmRun, between vmRun and vmResume and
+// after the VM exited) tasks run on the JDWP thread right away.
+//
+static void (* volatile safepointTasks[SAFEPOINT_TASKS])(void);
+static volatile uint32_t safepointHead = 0;   // next slot to fill, JDWP thread
+static volatile uint32_t safepointTail = 0;   // next slot to run, VM thread
+static pthread_mutex_t   safepointMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    safepointDone  = PTHREAD_COND_INITIALIZER;
+static volatile u1       vmStarted = FALSE;
+static pthread_t         vmThread;
+
+// VM thread: run every queued task
+static void runSafepoint() {
+  uint32_t tail = safepointTail;
+  void (*task)(void);
+
+  // clear first, a task queued while draining sets it again
+  __atomic_store_n(&safepointWord, 0, __ATOMIC_SEQ_CST);
+
+  while (tail != __atomic_load_n(&safepointHead, __ATOMIC_ACQUIRE)) {
+    // claim it, NULL if its waiter timed out and took it back
+    task = __atomic_exchange_n(&safepointTasks[tail & (SAFEPOINT_TASKS-1)], NULL, __ATOMIC_ACQ_REL);
+    if (task != NULL) task();
+    tail++;
+
+    pthread_mutex_lock(&safepointMutex);
+    __atomic_store_n(&safepointTail, tail, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&safepointDone);
+    pthread_mutex_unlock(&safepointMutex);
+  }
+}
+
+// JDWP thread: run task on the VM thread and wait for it; FALSE if
+// the VM thread did not reach a safepoint in time and task did not run
+static u1 atSafepoint(void (*task)(void)) {
+  uint32_t ticket;
+  struct timespec deadline;
+  int slot;
+  u1 done;
+
+  // while no scode runs, or from the VM thread itself, there is
+  // nobody to race with
+  if (!vmStarted || pthread_equal(pthread_self(), vmThread)) {
+    task();
+    return TRUE;
+  }
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += SAFEPOINT_TIMEOUT_S;
+
+  ticket = safepointHead;
+  slot   = ticket & (SAFEPOINT_TASKS-1);
+  pthread_mutex_lock(&safepointMutex);
+  while (vmStarted && ticket - safepointTail >= SAFEPOINT_TASKS)
+    if (pthread_cond_timedwait(&safepointDone, &safepointMutex, &deadline) == ETIMEDOUT) break;
+  done = !vmStarted;
+  if (!done && ticket - safepointTail >= SAFEPOINT_TASKS) {  // ring full of given up tasks
+    pthread_mutex_unlock(&safepointMutex);
+    return FALSE;
+  }
+  pthread_mutex_unlock(&safepointMutex);
+  if (done) {
+    task();
+    return TRUE;
+  }
+
+  __atomic_store_n(&safepointTasks[slot], task, __ATOMIC_RELEASE);
+  __atomic_store_n(&safepointHead, ticket + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&safepointWord, 1, __ATOMIC_SEQ_CST);
+  wakeVM();
+
+  pthread_mutex_lock(&safepointMutex);
+  while (vmStarted && (int32_t)(safepointTail - ticket) <= 0)
+    if (pthread_cond_timedwait(&safepointDone, &safepointMutex, &deadline) == ETIMEDOUT) break;
+  done = (int32_t)(safepointTail - ticket) > 0;
+  pthread_mutex_unlock(&safepointMutex);
+  if (done) return TRUE;
+
+  // take it back, unless the VM thread claimed it and is running it
+  if (__atomic_exchange_n(&safepointTasks[slot], NULL, __ATOMIC_ACQ_REL) == NULL) {
+    pthread_mutex_lock(&safepointMutex);
+    while ((int32_t)(safepointTail - ticket) <= 0)
+      pthread_cond_wait(&safepointDone, &safepointMutex);
+    pthread_mutex_unlock(&safepointMutex);
+    return TRUE;
+  }
+
+  // the VM left scode meanwhile, run it here
+  if (!vmStarted) {
+    task();
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// VM thread: enters or leaves scode, waiters on a safepoint that will
+// not come are woken to run their task themselves
+static void setVmStarted(u1 started) {
+  pthread_mutex_lock(&safepointMutex);
+  vmThread  = pthread_self();
+  vmStarted = started;
+  pthread_cond_broadcast(&safepointDone);
+  pthread_mutex_unlock(&safepointMutex);
 }
 #endif
 
@@ -202,6 +861,7 @@ inline static void onVM_Resume(){
 // Internal Forwards
 //////////////////////////////////////////////////////////////////////////
 static int vmInit(SedonaVM* vm);
+static int vmResolveNatives(SedonaVM* vm);
 static int vmEntry(SedonaVM* vm, int methodOffset);
 
 //////////////////////////////////////////////////////////////////////////
@@ -234,6 +894,9 @@ int vmRun(SedonaVM* vm)
   if (result != 0) return result;
 
   #ifdef VM_DEBUG_MODE
+    debugCodeBase = (uint8_t*)vm->codeBaseAddr;
+    debugCodeSize = vm->codeSize;
+    bindMainMethod(vm);
     init__VM_DEBUG_MODE();
   #endif // VM_DEBUG_MODE
 
@@ -273,11 +936,51 @@ static int vmEntry(SedonaVM* vm, int methodOffset)
   args[0].aval = (void*)vm->args;
   args[1].ival = vm->argsLen;
 
+  #ifdef VM_DEBUG_MODE
+    setVmStarted(TRUE);
+  #endif
   result = vm->call(vm, mainBix, args, 2);
+  #ifdef VM_DEBUG_MODE
+    setVmStarted(FALSE);  // main returned or hibernates, see vmResume
+  #endif
 
   return result;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Inline Calls
+//////////////////////////////////////////////////////////////////////////
+
+/**
+ * Queue a void method to run in the active interpreter loop as soon
+ * as the calling native returns.  The loop pushes args and a frame
+ * whose return address is the instruction after the native call, so
+ * no new C frame or loop setup is needed; the native's own result
+ * stays on the stack underneath.  This is only valid from a native
+ * invoked by the interpreter, and the native must return right away.
+ *
+ * Returns FALSE if the call can't be queued (too many args, arg count
+ * mismatch, or one already pending) in which case use vm->call.
+ */
+
+// vm->inlineMethod set by missingNative, never a queued call
+#define MISSING_NATIVE_CALL 0xFFFF
+
+bool vmCallInline(SedonaVM* vm, uint16_t method, Cell* args, int argc)
+{
+  const uint8_t* addr = block2addr(vm->codeBaseAddr, method);
+  int i;
+
+  if (vm->inlineMethod != 0 || method == MISSING_NATIVE_CALL ||
+      argc > VM_INLINE_MAX_ARGS || addr[0] != argc)
+    return FALSE;
+
+  for (i=0; i<argc; ++i) vm->inlineArgs[i] = args[i];
+  vm->inlineArgc   = (uint8_t)argc;
+  vm->inlineMethod = method;
+  return TRUE;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Init
 //////////////////////////////////////////////////////////////////////////
@@ -289,6 +992,7 @@ static int vmInit(SedonaVM* vm)
 {
   uint8_t* cb = (uint8_t*)vm->codeBaseAddr;
   uint32_t u4;
+  int result;
 
   // check magic (which also checks endian)
   u4 = *(uint32_t*)(cb+0);
@@ -317,6 +1021,13 @@ static int vmInit(SedonaVM* vm)
   vm->assertSuccesses = 0;
   vm->assertFailures = 0;
 
+  // no inline call pending
+  vm->inlineMethod = 0;
+
+  // swap in a fully populated native table
+  result = vmResolveNatives(vm);
+  if (result != 0) return result;
+
   // init globals
   zeroCell.ival   = 0;
   oneCell.ival    = 1;
@@ -326,6 +1037,90 @@ static int vmInit(SedonaVM* vm)
   return 0;
 }
 
+/**
+ * A native with no implementation.  Call sites are never checked at
+ * runtime, so anything the image references but the VM doesn't have
+ * lands here.  It only flags the call in vm->inlineMethod, which the
+ * loop tests after every native anyway; the loop then reports the
+ * call site with missingNativeCalled.
+ */
+static Cell missingNative(SedonaVM* vm, Cell* params)
+{
+  vm->inlineMethod = MISSING_NATIVE_CALL;
+  return zeroCell;
+}
+
+/**
+ * Report the kit::method ids of the native call at cp that had no
+ * implementation and return ERR_MISSING_NATIVE for vmCall to return.
+ */
+static int missingNativeCalled(SedonaVM* vm, const uint8_t* cp)
+{
+  vm->inlineMethod = 0;
+  printf("ERROR: missing native method %d::%d\n", cp[1], cp[2]);
+#ifdef SCODE_DEBUG
+  dumpStack(vm, vm->sp);
+#endif
+  return ERR_MISSING_NATIVE;
+}
+
+/**
+ * Build a native table with a row for every possible kit id and an
+ * entry for every possible method id, validated once against the
+ * host's table (including plugin kits) with isNativeIdValid.  Holes
+ * point to missingNative, so CallNative, CallNativeWide and
+ * CallNativeVoid are a single unchecked indirect call.
+ */
+#define NATIVE_IDS 256
+
+static NativeMethod** resolvedNatives = NULL;
+static NativeMethod*  missingRow      = NULL;
+
+static int vmResolveNatives(SedonaVM* vm)
+{
+  NativeMethod** src = vm->nativeTable;
+  int k, m;
+
+  // restart with a new image, host re-supplies its own table
+  if (src == resolvedNatives) return 0;
+
+  if (resolvedNatives != NULL)
+  {
+    for (k=0; k<NATIVE_IDS; ++k)
+      if (resolvedNatives[k] != missingRow) free(resolvedNatives[k]);
+    free(resolvedNatives);
+    free(missingRow);
+  }
+
+  resolvedNatives = (NativeMethod**)malloc(NATIVE_IDS * sizeof(NativeMethod*));
+  missingRow      = (NativeMethod*)malloc(NATIVE_IDS * sizeof(NativeMethod));
+  if (resolvedNatives == NULL || missingRow == NULL) return ERR_MALLOC_STATIC_DATA;
+
+  for (m=0; m<NATIVE_IDS; ++m) missingRow[m] = missingNative;
+
+  for (k=0; k<NATIVE_IDS; ++k)
+  {
+    NativeMethod* row = NULL;
+
+    for (m=0; m<NATIVE_IDS; ++m)
+    {
+      if (!isNativeIdValid(k, m)) continue;
+      if (row == NULL)
+      {
+        row = (NativeMethod*)malloc(NATIVE_IDS * sizeof(NativeMethod));
+        if (row == NULL) return ERR_MALLOC_STATIC_DATA;
+        memcpy(row, missingRow, NATIVE_IDS * sizeof(NativeMethod));
+      }
+      row[m] = src[k][m];
+    }
+
+    resolvedNatives[k] = row != NULL ? row : missingRow;
+  }
+
+  vm->nativeTable = resolvedNatives;
+  return 0;
+}
+
 /**
  * Initialize the pointers of an inline object array.  All object arrays
  * are arrays of references to keep array pointer arthimetic simple.  So
@@ -469,13 +1264,15 @@ const char* curMethod(SedonaVM* vm, Cell* fp)
   // method address is stored +2 from frame pointer in stack
   p = (uint8_t*)(fp+2)->aval;
 
-  // code start is +2 from method address, then skip any nops
+  // code start is +2 from method address, then skip any nops;
+  // opcode values are literal here, computed goto builds only have
+  // the opcode names as labels
   p += 2;
-  while(*p == Nop) ++p;
+  while(*p == 0) ++p;    // Nop
 
   // if the first opcode is MetaSlot that is our current
   // method qname otherwise we don't have debug compiled in
-  if (*p != MetaSlot) return "unknown";
+  if (*p != 236) return "unknown";    // MetaSlot
   block = *(uint16_t*)(p+1);
   return qnameSlot(vm, block);
 }
@@ -490,7 +1287,7 @@ const char* opcodeToName(int opcode)
 {
   static char temp[6];
 
-  if (0 <= opcode && opcode < NumOpcodes)
+  if (0 <= opcode && opcode < (int)(sizeof(OpcodeNames)/sizeof(OpcodeNames[0])))
   {
     return OpcodeNames[opcode];
   }
@@ -542,13 +1339,18 @@ int handleStackOverflow(SedonaVM* vm, int opcode, Cell* fp, Cell* sp)
 // These stuff are declared in the scope of vm.c, so later other extern methods can access them
 // e.g debug server on events, reading data or setting triggers etc
 
+//
+// The debug loop.  On a normal return of the called method its
+// result cells (0, 1 or 2) are stored in result and their count in
+// resultCells; on an error exit resultCells stays -1 and the error
+// code is returned.  Each call owns its result, so calls nested
+// through natives can't see each other's.
+//
+static int debugLoop(SedonaVM* vm, methodid_t methodid, Cell* args, int argc, Cell* result, int* resultCells)
+{
 #ifdef COMPUTED_GOTO
-  static void* opcodeLabels[] = OpcodeLabelsArray;
+    static void* opcodeLabels[] = OpcodeLabelsArray;
 #endif
-
-
-int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
-{
     Cell* sp;               // stack pointer
     uint8_t* cp;            // code pointer
     uint8_t* cb;            // code base
@@ -565,6 +1367,9 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
     int64_t s8;             // temp signed 64-bit long
     Cell* maxStackAddr;     // pointer to top of stack area
     NativeMethod** nativeTable;  // cached pointer to native table
+    uint8_t op;             // opcode at cp, original one under a breakpoint
+
+  *resultCells = -1;
 
   // init pointers
   sp = vm->sp;
@@ -601,44 +1406,45 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
   cp += 2;             // advance to first opcode
 
 #ifdef COMPUTED_GOTO
-  // lookup next label for instruction and jump using computed goto;
-  // this optimization is only available for GCC, however it can shave
-  // off a few machine instructions for each opcode (see sedona.h)
-  nextInstr: goto *opcodeLabels[*cp];
+  // every opcode comes back here to be checked, then jumps to its
+  // label using computed goto (see sedona.h)
+  nextInstr:
 #else
   // loop forever if not using computed gotos
   for (;;)
   {
 #endif
 
+    // breakpoint trap, run the patched out opcode once reported
+    op = *cp;
+    if (op == Breakpoint && (op = onBreakpoint(cp)) == Breakpoint)
+        return ERR_UNKNOWN_OPCODE;
+    if (op >= NUM_DEBUG_OPCODES)
+        return ERR_UNKNOWN_OPCODE;
+
     // check for null pointer
-    int offset = OpcodePointerOffsets[*cp];
+    int offset = OpcodePointerOffsets[op];
     if (offset >= 0 && ((sp-offset)->aval) == NULL)
-        return handleNullPointer(vm, *cp, fp, sp);
+        return handleNullPointer(vm, op, fp, sp);
 
     // check for stack overflow
     if (sp >= maxStackAddr)
-        return handleStackOverflow(vm, *cp, fp, sp);
+        return handleStackOverflow(vm, op, fp, sp);
 
 
     //dumpStack(vm, sp);
     //printf("  -- opcode = [%d]  %s\n", cp-cb, opcodeToName(*cp));
     //printf("CodePointer = %i\n", *cp);
-#ifndef COMPUTED_GOTO
-    // process next opcode using switch if not using computed gotos
-    //onEvent_callback(0, 0);
 
-    EventHandler->check_forEvents(*cp, sp, fp, methodid);
-    while(isVM_Suspended() == TRUE) {
-        while(EventHandler->canDispatchAll() == FALSE) {
-            sleep(VM_WAIT_ONHOLD);
-        }
-
-        EventHandler->dispatchAll(); // should be only queued waiters
-        onVM_Resume();
-    }
+    if (*EventHandler->armed)
+      EventHandler->check_forEvents(cp, sp, fp, ((uint8_t*)fp[2].aval - cb) / SCODE_BLOCK_SIZE);
+    waitWhileSuspended();
 
-    switch (*cp)
+#ifdef COMPUTED_GOTO
+    goto *opcodeLabels[op];
+#else
+    // process next opcode using switch if not using computed gotos
+    switch (op)
     {
 #endif
 
@@ -896,12 +1702,12 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
       ////////////////////////////////////////////////////////////////////
 
       Case Jump:
-        cp += *(int8_t*)(cp+1);
+        Branch(*(int8_t*)(cp+1));
         EndInstr;
 
       Case JumpZero:
         if (!sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         --sp;
@@ -909,7 +1715,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpNonZero:
         if (sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         --sp;
@@ -918,7 +1724,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
       Case Foreach:
         if (++(sp->ival) >= (sp-1)->ival)
         {
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         }
         else
         {
@@ -935,12 +1741,12 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
       ////////////////////////////////////////////////////////////////////
 
       Case JumpFar:
-        cp += *(int16_t*)(cp+1);
+        Branch(*(int16_t*)(cp+1));
         EndInstr;
 
       Case JumpFarZero:
         if (!sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         --sp;
@@ -948,7 +1754,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarNonZero:
         if (sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         --sp;
@@ -957,7 +1763,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
       Case ForeachFar:
         if (++(sp->ival) >= (sp-1)->ival)
         {
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         }
         else
         {
@@ -975,7 +1781,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntEq:
         if ((sp-1)->ival == sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -983,7 +1789,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntNotEq:
         if ((sp-1)->ival != sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -991,7 +1797,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntGt:
         if ((sp-1)->ival > sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -999,7 +1805,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntGtEq:
         if ((sp-1)->ival >= sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1007,7 +1813,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntLt:
         if ((sp-1)->ival < sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1015,7 +1821,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpIntLtEq:
         if ((sp-1)->ival <= sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1027,7 +1833,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntEq:
         if ((sp-1)->ival == sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1035,7 +1841,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntNotEq:
         if ((sp-1)->ival != sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1043,7 +1849,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntGt:
         if ((sp-1)->ival > sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1051,7 +1857,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntGtEq:
         if ((sp-1)->ival >= sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1059,7 +1865,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntLt:
         if ((sp-1)->ival < sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1067,7 +1873,7 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
 
       Case JumpFarIntLtEq:
         if ((sp-1)->ival <= sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1185,7 +1991,8 @@ int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
         addr = block2addr(cb, u2); // address of target method
         (++sp)->aval = cp+3;       // push return cp onto stack
         // common
-call:   (++sp)->aval = fp;         // push old frame pointer
+call:   Safepoint();
+        (++sp)->aval = fp;         // push old frame pointer
         (++sp)->aval = addr;       // push new method pointer
         fp = sp-2;                 // update new frame pointer
         numParams = addr[0];       // update new num params
@@ -1216,11 +2023,6 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         goto call;                     // reuse common call implementation
 
       Case CallNative:
-        if (!isNativeIdValid(*(cp+1), *(cp+2)))
-        {
-          printf("ERROR: missing  native method %d::%d\n", *(cp+1), *(cp+2));
-          return ERR_MISSING_NATIVE;
-        }
         native = nativeTable[*(cp+1)][*(cp+2)];  // lookup native func ptr
         u2 = *(cp+3);                  // num params in scode itself
         vm->sp = sp;                   // save stack pointer before calling out
@@ -1228,15 +2030,11 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         cp += 4;                       // advance to next instruction
         sp -= u2-1;                    // pop stack back down to param0
         *sp = cell;                    // push result on stack
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
 // TODO - collapse code with CallNative?
       Case CallNativeWide:
-        if (!isNativeIdValid( *(cp+1), *(cp+2)))
-        {
-          printf("ERROR: missing  native method %d::%d\n", *(cp+1), *(cp+2));
-          return ERR_MISSING_NATIVE;
-        }
         native = nativeTable[*(cp+1)][*(cp+2)];  // lookup native func ptr
         u2 = *(cp+3);                  // num params in scode itself
         vm->sp = sp;                   // save stack pointer before calling out
@@ -1245,6 +2043,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         sp -= u2-1;                    // pop stack back down to param0
         *(int64_t*)sp = s8;            // push result on stack
         ++sp;
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
       Case CallNativeVoid:
@@ -1254,8 +2053,20 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         native(vm, sp-u2+1);           // call native method
         cp += 4;                       // advance to next instruction
         sp -= u2;                      // pop stack back down to param0-1
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
+      // run a method queued by the native with vmCallInline as if
+      // scode had called it from the instruction after the native
+inlineCall:
+        if (vm->inlineMethod == MISSING_NATIVE_CALL)
+          return missingNativeCalled(vm, cp-4);
+        for (u2 = 0; u2 < vm->inlineArgc; ++u2) *(++sp) = vm->inlineArgs[u2];
+        addr = block2addr(cb, vm->inlineMethod);
+        vm->inlineMethod = 0;
+        (++sp)->aval = cp;             // push return cp onto stack
+        goto call;                     // reuse common call implementation
+
       Case ReturnPop:
 //printf("<- %s\n", curMethod(vm, fp));
         // check stack balancing on unwind
@@ -1272,6 +2083,8 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         cp = fp[0].aval;           // pop code pointer
         if (cp == 0)               // if unwinding main method itself
         {
+          result[0]    = cell;
+          *resultCells = 1;
           return cell.ival;
         }
         fp   = fp[1].aval;         // pop old frame pointer
@@ -1281,6 +2094,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         pp = fp-numParams;         // update param 0 pointer
         lp = fp+3;                 // update local 0 pointer
         *sp = cell;                // push result onto stack
+        Safepoint();
         EndInstr;
 
 // TODO - collapse this code with ReturnPop
@@ -1300,6 +2114,8 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         cp = fp[0].aval;           // pop code pointer
         if (cp == 0)               // if unwinding main method itself
         {
+          *(int64_t*)result = s8;
+          *resultCells = 2;
           return 0;
         }
         fp   = fp[1].aval;         // pop old frame pointer
@@ -1310,6 +2126,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         lp = fp+3;                 // update local 0 pointer
         *(int64_t*)sp = s8;        // push result onto stack
         sp++;
+        Safepoint();
         EndInstr;
 
       Case ReturnVoid:
@@ -1327,6 +2144,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         cp = fp[0].aval;           // pop code pointer
         if (cp == 0)               // if unwinding main method itself
         {
+          *resultCells = 0;
           return sp->ival;
         }
         fp   = fp[1].aval;         // pop old frame pointer
@@ -1335,6 +2153,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         numLocals = addr[1];       // update old num locals
         pp = fp-numParams;         // update param 0 pointer
         lp = fp+3;                 // update local 0 pointer
+        Safepoint();
         EndInstr;
 
       ////////////////////////////////////////////////////////////////////
@@ -1427,6 +2246,14 @@ call:   (++sp)->aval = fp;         // push old frame pointer
 #endif
 }
 
+int vmCallDebug(SedonaVM* vm, methodid_t methodid, Cell* args, int argc)
+{
+  Cell result[2];
+  int resultCells;
+
+  return debugLoop(vm, methodid, args, argc, result, &resultCells);
+}
+
 #endif // VM_DEBUG_MODE
 
 //////////////////////////////////////////////////////////////////////////
@@ -1460,6 +2287,11 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 {
 #ifdef COMPUTED_GOTO
   static void* opcodeLabels[] = OpcodeLabelsArray;
+ #ifdef VM_DEBUG_MODE
+  // opcodeLabels for every byte value, so a Breakpoint trap (and any
+  // other byte past the opcodes) dispatches to a label of its own
+  static void* trapLabels[256];
+ #endif
 #endif
   register Cell* sp;      // stack pointer
   register uint8_t* cp;   // code pointer
@@ -1477,6 +2309,10 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
   int64_t s8;             // temp signed 64-bit long
   Cell* maxStackAddr;     // pointer to top of stack area
   NativeMethod** nativeTable;  // cached pointer to native table
+#ifdef VM_DEBUG_MODE
+  Cell debugResult[2];    // result of a call run by debugLoop
+  int  debugResultCells;  // its size in cells, -1 on error
+#endif
 
   // init pointers
   sp = vm->sp;
@@ -1505,6 +2341,15 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
   cp += 2;             // advance to first opcode
 
 #ifdef COMPUTED_GOTO
+ #ifdef VM_DEBUG_MODE
+  if (trapLabels[Breakpoint] == NULL)
+  {
+    for (u2 = 0; u2 < 256; ++u2)
+      trapLabels[u2] = u2 < sizeof(opcodeLabels)/sizeof(opcodeLabels[0]) ? opcodeLabels[u2] : &&unknownOpcode;
+    trapLabels[Breakpoint] = &&breakpointTrap;
+  }
+  #define opcodeLabels trapLabels
+ #endif
   // lookup next label for instruction and jump using computed goto;
   // this optimization is only available for GCC, however it can shave
   // off a few machine instructions for each opcode (see sedona.h)
@@ -1517,14 +2362,20 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
     // if debug
     #ifdef SCODE_DEBUG
+      uint8_t op = *cp;
+    #ifdef VM_DEBUG_MODE
+      // a breakpoint trap is checked as the opcode it replaced
+      if (op == Breakpoint) op = patchedOpcode(cp);
+    #endif
+
       // check for null pointer
-      int offset = OpcodePointerOffsets[*cp];
+      int offset = OpcodePointerOffsets[op];
       if (offset >= 0 && ((sp-offset)->aval) == NULL)
-        return handleNullPointer(vm, *cp, fp, sp);
+        return handleNullPointer(vm, op, fp, sp);
 
       // check for stack overflow
       if (sp >= maxStackAddr)
-        return handleStackOverflow(vm, *cp, fp, sp);
+        return handleStackOverflow(vm, op, fp, sp);
 
     #endif
 
@@ -1533,7 +2384,13 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
 #ifndef COMPUTED_GOTO
     // process next opcode using switch if not using computed gotos
+  #ifdef VM_DEBUG_MODE
+    u2 = *cp;
+dispatch:
+    switch (u2)
+  #else
     switch (*cp)
+  #endif
     {
 #endif
       ////////////////////////////////////////////////////////////////////
@@ -1790,12 +2647,12 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
       ////////////////////////////////////////////////////////////////////
 
       Case Jump:
-        cp += *(int8_t*)(cp+1);
+        Branch(*(int8_t*)(cp+1));
         EndInstr;
 
       Case JumpZero:
         if (!sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         --sp;
@@ -1803,7 +2660,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpNonZero:
         if (sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         --sp;
@@ -1812,7 +2669,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
       Case Foreach:
         if (++(sp->ival) >= (sp-1)->ival)
         {
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         }
         else
         {
@@ -1829,12 +2686,12 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
       ////////////////////////////////////////////////////////////////////
 
       Case JumpFar:
-        cp += *(int16_t*)(cp+1);
+        Branch(*(int16_t*)(cp+1));
         EndInstr;
 
       Case JumpFarZero:
         if (!sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         --sp;
@@ -1842,7 +2699,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarNonZero:
         if (sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         --sp;
@@ -1851,7 +2708,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
       Case ForeachFar:
         if (++(sp->ival) >= (sp-1)->ival)
         {
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         }
         else
         {
@@ -1869,7 +2726,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntEq:
         if ((sp-1)->ival == sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1877,7 +2734,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntNotEq:
         if ((sp-1)->ival != sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1885,7 +2742,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntGt:
         if ((sp-1)->ival > sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1893,7 +2750,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntGtEq:
         if ((sp-1)->ival >= sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1901,7 +2758,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntLt:
         if ((sp-1)->ival < sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1909,7 +2766,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpIntLtEq:
         if ((sp-1)->ival <= sp->ival)
-          cp += *(int8_t*)(cp+1);
+          Branch(*(int8_t*)(cp+1));
         else
           cp += 2;
         sp -= 2;
@@ -1921,7 +2778,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntEq:
         if ((sp-1)->ival == sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1929,7 +2786,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntNotEq:
         if ((sp-1)->ival != sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1937,7 +2794,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntGt:
         if ((sp-1)->ival > sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1945,7 +2802,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntGtEq:
         if ((sp-1)->ival >= sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1953,7 +2810,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntLt:
         if ((sp-1)->ival < sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -1961,7 +2818,7 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
 
       Case JumpFarIntLtEq:
         if ((sp-1)->ival <= sp->ival)
-          cp += *(int16_t*)(cp+1);
+          Branch(*(int16_t*)(cp+1));
         else
           cp += 3;
         sp -= 2;
@@ -2079,7 +2936,12 @@ int vmCall(SedonaVM* vm, uint16_t method, Cell* args, int argc)
         addr = block2addr(cb, u2); // address of target method
         (++sp)->aval = cp+3;       // push return cp onto stack
         // common
-call:   (++sp)->aval = fp;         // push old frame pointer
+call:
+        Safepoint();
+#ifdef VM_DEBUG_MODE
+        if (*debugActive || suspendCounter != 0) goto debugCall;
+#endif
+        (++sp)->aval = fp;         // push old frame pointer
         (++sp)->aval = addr;       // push new method pointer
         fp = sp-2;                 // update new frame pointer
         numParams = addr[0];       // update new num params
@@ -2110,13 +2972,6 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         goto call;                     // reuse common call implementation
 
       Case CallNative:
-#ifdef SCODE_DEBUG
-        if (!isNativeIdValid(*(cp+1), *(cp+2)))
-        {
-          printf("ERROR: missing  native method %d::%d\n", *(cp+1), *(cp+2));
-          return ERR_MISSING_NATIVE;
-        }
-#endif
         native = nativeTable[*(cp+1)][*(cp+2)];  // lookup native func ptr
         u2 = *(cp+3);                  // num params in scode itself
         vm->sp = sp;                   // save stack pointer before calling out
@@ -2124,17 +2979,11 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         cp += 4;                       // advance to next instruction
         sp -= u2-1;                    // pop stack back down to param0
         *sp = cell;                    // push result on stack
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
 // TODO - collapse code with CallNative?
       Case CallNativeWide:
-#ifdef SCODE_DEBUG
-        if (!isNativeIdValid( *(cp+1), *(cp+2)))
-        {
-          printf("ERROR: missing  native method %d::%d\n", *(cp+1), *(cp+2));
-          return ERR_MISSING_NATIVE;
-        }
-#endif
         native = nativeTable[*(cp+1)][*(cp+2)];  // lookup native func ptr
         u2 = *(cp+3);                  // num params in scode itself
         vm->sp = sp;                   // save stack pointer before calling out
@@ -2143,6 +2992,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         sp -= u2-1;                    // pop stack back down to param0
         *(int64_t*)sp = s8;            // push result on stack
         ++sp;
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
       Case CallNativeVoid:
@@ -2152,8 +3002,46 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         native(vm, sp-u2+1);           // call native method
         cp += 4;                       // advance to next instruction
         sp -= u2;                      // pop stack back down to param0-1
+        if (vm->inlineMethod) goto inlineCall;
         EndInstr;                      // keep chugging
 
+      // run a method queued by the native with vmCallInline as if
+      // scode had called it from the instruction after the native
+inlineCall:
+        if (vm->inlineMethod == MISSING_NATIVE_CALL)
+          return missingNativeCalled(vm, cp-4);
+        for (u2 = 0; u2 < vm->inlineArgc; ++u2) *(++sp) = vm->inlineArgs[u2];
+        addr = block2addr(cb, vm->inlineMethod);
+        vm->inlineMethod = 0;
+        (++sp)->aval = cp;             // push return cp onto stack
+        goto call;                     // reuse common call implementation
+
+#ifdef VM_DEBUG_MODE
+      // a debugger is active: run the callee in debugLoop and
+      // continue this frame here once it returns.  Known limitation:
+      // the callee starts a fresh debug frame chain with return cp and
+      // prev fp of 0, so the debugger does not see the frames still
+      // running here, and a step out or step over at the callee's
+      // return lands back in this loop, which cannot report it; the
+      // step completes at the next breakpoint or debugged call.
+debugCall:
+        cp = sp->aval;                 // pop return cp
+        u2 = addr[0];                  // callee num params
+        sp -= u2+1;                    // pop stack back down to param0-1
+        vm->sp = sp;                   // args are copied onto themselves
+        cell.ival = debugLoop(vm, (uint16_t)((addr-cb)/SCODE_BLOCK_SIZE), sp+1, u2, debugResult, &debugResultCells);
+        if (debugResultCells < 0) return cell.ival;
+        if (debugResultCells == 1)
+          *(++sp) = debugResult[0];
+        else if (debugResultCells == 2)
+        {
+          *(int64_t*)(++sp) = *(int64_t*)debugResult;
+          ++sp;
+        }
+        numParams = ((uint8_t*)fp[2].aval)[0];  // restore our num params
+        EndInstr;
+#endif
+
       Case ReturnPop:
 //printf("<- %s\n", curMethod(vm, fp));
         // check stack balancing on unwind
@@ -2181,6 +3069,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         pp = fp-numParams;         // update param 0 pointer
         lp = fp+3;                 // update local 0 pointer
         *sp = cell;                // push result onto stack
+        Safepoint();
         EndInstr;
 
 // TODO - collapse this code with ReturnPop
@@ -2212,6 +3101,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         lp = fp+3;                 // update local 0 pointer
         *(int64_t*)sp = s8;        // push result onto stack
         sp++;
+        Safepoint();
         EndInstr;
 
       Case ReturnVoid:
@@ -2239,6 +3129,7 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         numLocals = addr[1];       // update old num locals
         pp = fp-numParams;         // update param 0 pointer
         lp = fp+3;                 // update local 0 pointer
+        Safepoint();
         EndInstr;
 
       ////////////////////////////////////////////////////////////////////
@@ -2326,6 +3217,29 @@ call:   (++sp)->aval = fp;         // push old frame pointer
         return ERR_UNKNOWN_OPCODE;
 
 
+#ifdef VM_DEBUG_MODE
+      // breakpoint patched into a frame running here, report it
+      // and run the original opcode
+  #ifdef COMPUTED_GOTO
+      breakpointTrap:
+  #else
+      Case Breakpoint:
+  #endif
+        u2 = onBreakpoint(cp);
+        waitWhileSuspended();
+        if (u2 == Breakpoint) return ERR_UNKNOWN_OPCODE;
+  #ifdef COMPUTED_GOTO
+        goto *opcodeLabels[u2];
+
+      unknownOpcode:
+        return ERR_UNKNOWN_OPCODE;
+
+    #undef opcodeLabels
+  #else
+        goto dispatch;
+  #endif
+#endif
+
 #ifndef COMPUTED_GOTO
       default:
         #ifdef SCODE_DEBUG